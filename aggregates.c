@@ -0,0 +1,209 @@
+#include "aggregates.h"
+#include "text_match.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Tamanho das chaves dobradas na pilha; chaves maiores usam memória alocada
+#define AGGREGATE_KEY_BUFFER 256
+
+// Hash FNV-1a da chave já dobrada
+static unsigned int hash_key(const char *key, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Posição da chave na tabela hash (endereçamento aberto com sondagem linear):
+// a da entrada existente ou a primeira posição livre
+static size_t find_slot(aggregate_entry **slots, size_t slot_count, const char *key, size_t length,
+                        unsigned int hash) {
+    size_t mask = slot_count - 1;
+    size_t i = hash & mask;
+    while (slots[i]) {
+        aggregate_entry *entry = slots[i];
+        if (entry->hash == hash && entry->key_length == length && memcmp(entry->key, key, length) == 0) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Dobra a tabela hash quando ela passa da metade da ocupação
+static int grow_slots(aggregate_table *table) {
+    size_t slot_count = table->slot_count ? table->slot_count * 2 : 64;
+    aggregate_entry **slots = calloc(slot_count, sizeof(aggregate_entry *));
+    if (!slots) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < table->count; i++) {
+        aggregate_entry *entry = table->order[i];
+        slots[find_slot(slots, slot_count, entry->key, entry->key_length, entry->hash)] = entry;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = slot_count;
+    return 0;
+}
+
+// Inicializa uma tabela vazia
+void aggregate_table_init(aggregate_table *table) {
+    memset(table, 0, sizeof(*table));
+}
+
+// Libera as entradas e a própria tabela
+void aggregate_table_free(aggregate_table *table) {
+    for (size_t i = 0; i < table->count; i++) {
+        free(table->order[i]->key);
+        free(table->order[i]->label);
+        free(table->order[i]);
+    }
+    free(table->slots);
+    free(table->order);
+    aggregate_table_init(table);
+}
+
+// Procura uma chave já dobrada
+static aggregate_entry *lookup(const aggregate_table *table, const char *key, size_t length, unsigned int hash) {
+    if (!table->slot_count) {
+        return NULL;
+    }
+    return table->slots[find_slot(table->slots, table->slot_count, key, length, hash)];
+}
+
+// Procura a entrada de uma chave, sem diferenciar maiúsculas de minúsculas
+aggregate_entry *aggregate_table_find(const aggregate_table *table, const char *label) {
+    size_t length = strlen(label);
+    char buffer[AGGREGATE_KEY_BUFFER];
+    char *key = length <= sizeof(buffer) ? buffer : malloc(length);
+    if (!key) {
+        return NULL;
+    }
+
+    text_fold(label, length, key);
+    aggregate_entry *entry = lookup(table, key, length, hash_key(key, length));
+
+    if (key != buffer) {
+        free(key);
+    }
+    return entry;
+}
+
+// Cria a entrada de uma chave nova, com contagem zero, ao final da ordem
+static aggregate_entry *intern(aggregate_table *table, const char *label, size_t length, const char *key,
+                               unsigned int hash) {
+    if ((table->count + 1) * 2 > table->slot_count && grow_slots(table) != 0) {
+        return NULL;
+    }
+    if (table->count == table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 64;
+        aggregate_entry **order = realloc(table->order, capacity * sizeof(aggregate_entry *));
+        if (!order) {
+            return NULL;
+        }
+        table->order = order;
+        table->capacity = capacity;
+    }
+
+    aggregate_entry *entry = calloc(1, sizeof(aggregate_entry));
+    if (!entry) {
+        return NULL;
+    }
+    entry->key = malloc(length);
+    entry->label = strdup(label);
+    if (!entry->key || !entry->label) {
+        free(entry->key);
+        free(entry->label);
+        free(entry);
+        return NULL;
+    }
+
+    memcpy(entry->key, key, length);
+    entry->key_length = length;
+    entry->hash = hash;
+    entry->rank = table->count;
+
+    table->order[table->count++] = entry;
+    table->slots[find_slot(table->slots, table->slot_count, key, length, hash)] = entry;
+    return entry;
+}
+
+// Troca duas entradas de posição na ordem
+static void swap_ranks(aggregate_table *table, size_t a, size_t b) {
+    aggregate_entry *entry = table->order[a];
+    table->order[a] = table->order[b];
+    table->order[b] = entry;
+    table->order[a]->rank = a;
+    table->order[b]->rank = b;
+}
+
+// Incrementa o contador mantendo a ordem: a entrada troca de lugar com a primeira
+// de mesma contagem (busca binária), que passa a ser a última desse grupo
+static void increment(aggregate_table *table, aggregate_entry *entry) {
+    size_t low = 0;
+    size_t high = entry->rank;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (table->order[middle]->count > entry->count) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    swap_ranks(table, low, entry->rank);
+    entry->count++;
+}
+
+// Decrementa o contador trocando a entrada com a última de mesma contagem
+static void decrement(aggregate_table *table, aggregate_entry *entry) {
+    size_t low = entry->rank;
+    size_t high = table->count - 1;
+    while (low < high) {
+        size_t middle = (low + high + 1) / 2;
+        if (table->order[middle]->count < entry->count) {
+            high = middle - 1;
+        } else {
+            low = middle;
+        }
+    }
+    swap_ranks(table, low, entry->rank);
+    entry->count--;
+}
+
+// Soma delta ao contador da chave
+int aggregate_table_add(aggregate_table *table, const char *label, int delta) {
+    size_t length = strlen(label);
+    char buffer[AGGREGATE_KEY_BUFFER];
+    char *key = length <= sizeof(buffer) ? buffer : malloc(length);
+    if (!key) {
+        return -1;
+    }
+
+    text_fold(label, length, key);
+    unsigned int hash = hash_key(key, length);
+    aggregate_entry *entry = lookup(table, key, length, hash);
+    if (!entry && delta > 0) {
+        entry = intern(table, label, length, key, hash);
+    }
+
+    if (key != buffer) {
+        free(key);
+    }
+    if (!entry) {
+        return delta > 0 ? -1 : 0;
+    }
+
+    for (; delta > 0; delta--) {
+        increment(table, entry);
+    }
+    for (; delta < 0 && entry->count > 0; delta++) {
+        decrement(table, entry);
+    }
+    return 0;
+}
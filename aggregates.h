@@ -0,0 +1,37 @@
+#ifndef AGGREGATES_H
+#define AGGREGATES_H
+
+#include <stddef.h>
+
+// Contador de uma chave (um gênero, um diretor ou uma década)
+typedef struct {
+    char *key;
+    char *label;
+    size_t key_length;
+    unsigned int hash;
+    size_t count;
+    size_t rank;
+} aggregate_entry;
+
+// Tabela de contadores. As chaves são internadas em uma tabela hash, sem diferenciar
+// maiúsculas de minúsculas, e as entradas ficam em ordem por contagem decrescente:
+// o top-N é lido das primeiras posições, sem percorrer o catálogo.
+typedef struct {
+    aggregate_entry **slots;
+    size_t slot_count;
+    aggregate_entry **order;
+    size_t count;
+    size_t capacity;
+} aggregate_table;
+
+// Inicializa e libera uma tabela
+void aggregate_table_init(aggregate_table *table);
+void aggregate_table_free(aggregate_table *table);
+
+// Procura a entrada de uma chave; retorna NULL se ela nunca foi contada
+aggregate_entry *aggregate_table_find(const aggregate_table *table, const char *label);
+
+// Soma delta ao contador da chave, internando-a se necessário; retorna -1 se faltar memória
+int aggregate_table_add(aggregate_table *table, const char *label, int delta);
+
+#endif
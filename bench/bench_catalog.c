@@ -0,0 +1,356 @@
+// Benchmark das operações de json_operations.h sobre catálogos sintéticos
+//
+// Uso: bench_catalog [número de filmes ...]
+//
+// Para cada tamanho, gera um movies.json com distribuição enviesada de gêneros e
+// diretores em um diretório temporário e mede cada operação em um processo filho,
+// de modo que o pico de memória (ru_maxrss) seja o da própria operação.
+
+#define _GNU_SOURCE
+#include <malloc.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../json_operations.h"
+
+// Tempo mínimo de medição de cada operação e limite de iterações
+#define BENCH_MIN_TIME_NS 200000000.0
+#define BENCH_MAX_ITERATIONS 10000
+
+// Estimativa de memória por filme com o catálogo carregado, usada para pular
+// tamanhos que não cabem na máquina
+#define BENCH_BYTES_PER_MOVIE 1500
+
+static const char *genres[] = {
+    "Drama", "Comédia", "Ação", "Suspense", "Romance", "Terror", "Aventura",
+    "Ficção Científica", "Animação", "Documentário", "Crime", "Fantasia",
+    "Família", "Mistério", "Musical", "Guerra", "Biografia", "História",
+    "Faroeste", "Esporte",
+};
+
+static const char *words[] = {
+    "Noite", "Cidade", "Amor", "Guerra", "Sombra", "Estrela", "Caminho",
+    "Segredo", "Tempo", "Mar", "Fogo", "Sonho", "Última", "Missão", "Rei",
+};
+
+#define GENRE_COUNT (sizeof(genres) / sizeof(genres[0]))
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+// Gerador pseudoaleatório reprodutível (xorshift64*)
+static uint64_t rng_state = 42;
+
+static uint64_t next_random() {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+static double next_uniform() {
+    return (next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Distribuição de Zipf sobre count valores: a posição k tem peso 1 / (k + 1)^s
+typedef struct {
+    double *cumulative;
+    size_t count;
+} zipf_table;
+
+static void zipf_init(zipf_table *table, size_t count, double s) {
+    table->cumulative = malloc(count * sizeof(double));
+    table->count = count;
+
+    double total = 0;
+    for (size_t k = 0; k < count; k++) {
+        total += 1.0 / pow(k + 1, s);
+        table->cumulative[k] = total;
+    }
+    for (size_t k = 0; k < count; k++) {
+        table->cumulative[k] /= total;
+    }
+}
+
+static size_t zipf_sample(const zipf_table *table) {
+    double u = next_uniform();
+    size_t low = 0, high = table->count - 1;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (table->cumulative[middle] < u) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Tempo monotônico em nanossegundos
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Gera o catálogo: 1 a 3 gêneros por filme e um diretor por filme, ambos com
+// distribuição de Zipf, e anos concentrados nas décadas recentes
+static int generate_catalog(long count) {
+    FILE *file = fopen("movies.json", "w");
+    if (!file) {
+        return -1;
+    }
+
+    zipf_table genre_table, director_table;
+    size_t director_count = count / 20 > 10 ? count / 20 : 10;
+    zipf_init(&genre_table, GENRE_COUNT, 1.2);
+    zipf_init(&director_table, director_count, 1.0);
+    rng_state = 42;
+
+    fprintf(file, "{\"movies\": [");
+    for (long i = 0; i < count; i++) {
+        size_t picked[3];
+        int genre_total = 1 + (next_random() % 100 >= 50) + (next_random() % 100 >= 85);
+        int year = 2024 - (int)(pow(next_uniform(), 2) * 104);
+
+        fprintf(file, "%s\n{\"id\": %ld, \"title\": \"%s da %s %ld\", \"genres\": [", i ? "," : "", i + 1,
+                words[next_random() % WORD_COUNT], words[next_random() % WORD_COUNT], i + 1);
+
+        for (int g = 0; g < genre_total; g++) {
+            picked[g] = zipf_sample(&genre_table);
+            int repeated = 0;
+            for (int p = 0; p < g; p++) {
+                repeated |= picked[p] == picked[g];
+            }
+            if (!repeated) {
+                fprintf(file, "%s\"%s\"", g ? ", " : "", genres[picked[g]]);
+            }
+        }
+
+        fprintf(file, "], \"director\": \"Diretor %zu\", \"year\": %d}", zipf_sample(&director_table) + 1, year);
+    }
+    fprintf(file, "\n], \"last_id\": %ld}\n", count);
+
+    free(genre_table.cumulative);
+    free(director_table.cumulative);
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+// Operações medidas; i é o número da iteração (a iteração 0 é o aquecimento)
+static long catalog_size;
+
+static void op_get_next_id(long i) {
+    (void)i;
+    get_next_id();
+}
+
+static void op_list_all_titles(long i) {
+    (void)i;
+    free(list_all_titles());
+}
+
+static void op_list_all_movies(long i) {
+    (void)i;
+    free(list_all_movies());
+}
+
+static void op_get_movie_by_id(long i) {
+    free(get_movie_by_id(1 + (i * 7919) % catalog_size));
+}
+
+static void op_list_movies_by_genre(long i) {
+    // Alterna entre o gênero mais frequente e um raro
+    free(list_movies_by_genre(i % 2 ? "drama" : "Faroeste"));
+}
+
+static void op_search_movies_by_title(long i) {
+    (void)i;
+    free(search_movies_by_title("sombra da"));
+}
+
+static void op_top_aggregates(long i) {
+    free(top_aggregates(i % 2 ? AGGREGATE_DIRECTOR : AGGREGATE_GENRE, 10));
+}
+
+static void op_count_aggregate(long i) {
+    free(count_aggregate(AGGREGATE_DECADE, i % 2 ? "1995" : "2010"));
+}
+
+static void op_add_genre_to_movie(long i) {
+    char genre[32];
+    snprintf(genre, sizeof(genre), "Gênero %ld", i);
+    add_genre_to_movie(1 + (i * 7919) % catalog_size, genre);
+}
+
+static void op_add_movie(long i) {
+    (void)i;
+    add_movie("Filme de Benchmark", "Drama, Ação", "Diretor 1", 2024);
+}
+
+static void op_remove_movie(long i) {
+    remove_movie(i + 1);
+}
+
+static void op_apply_transaction(long i) {
+    (void)i;
+    db_operation ops[2] = {
+        {.type = DB_OP_ADD_MOVIE, .title = "Filme em Lote", .genres = "Comédia", .director = "Diretor 2", .year = 2001},
+        {.type = DB_OP_ADD_GENRE, .id_ref = 1, .genre = "Romance"},
+    };
+    size_t failed_index;
+    apply_transaction(ops, 2, &failed_index);
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(long i);
+} bench_op;
+
+// As leituras vêm antes das escritas, que alteram o catálogo das medições seguintes
+static const bench_op operations[] = {
+    {"get_next_id", op_get_next_id},
+    {"list_all_titles", op_list_all_titles},
+    {"list_all_movies", op_list_all_movies},
+    {"get_movie_by_id", op_get_movie_by_id},
+    {"list_movies_by_genre", op_list_movies_by_genre},
+    {"search_movies_by_title", op_search_movies_by_title},
+    {"top_aggregates", op_top_aggregates},
+    {"count_aggregate", op_count_aggregate},
+    {"add_genre_to_movie", op_add_genre_to_movie},
+    {"add_movie", op_add_movie},
+    {"remove_movie", op_remove_movie},
+    {"apply_transaction", op_apply_transaction},
+};
+
+// Resultado enviado pelo processo filho
+typedef struct {
+    long iterations;
+    double elapsed_ns;
+    long long retained_bytes;
+} bench_result;
+
+// Executa a operação no processo filho: uma chamada de aquecimento e depois
+// iterações até BENCH_MIN_TIME_NS
+static void run_child(const bench_op *op, int fd) {
+    bench_result result = {0, 0, 0};
+    size_t before = mallinfo2().uordblks;
+
+    op->run(0);
+
+    double start = now_ns();
+    while (result.iterations < BENCH_MAX_ITERATIONS && result.elapsed_ns < BENCH_MIN_TIME_NS) {
+        op->run(++result.iterations);
+        result.elapsed_ns = now_ns() - start;
+    }
+
+    result.retained_bytes = (long long)mallinfo2().uordblks - (long long)before;
+    ssize_t written = write(fd, &result, sizeof(result));
+    _exit(written == sizeof(result) ? 0 : 1);
+}
+
+// Mede uma operação e imprime sua linha na tabela
+static void measure(const bench_op *op) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        run_child(op, fds[1]);
+    }
+    close(fds[1]);
+
+    bench_result result;
+    ssize_t received = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0 || received != sizeof(result)) {
+        printf("%-24s %14s\n", op->name, "falhou");
+        return;
+    }
+
+    printf("%-24s %14.0f %10ld %14.1f %16.1f\n", op->name, result.elapsed_ns / result.iterations,
+           result.iterations, usage.ru_maxrss / 1024.0, result.retained_bytes / 1024.0);
+}
+
+// Remove o diretório temporário de um tamanho
+static void remove_workdir(const char *dir) {
+    char path[512];
+    const char *files[] = {"movies.json", "movies.json.tmp"};
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+static void bench_size(long count) {
+    double available = (double)sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+    double needed = (double)count * BENCH_BYTES_PER_MOVIE;
+
+    printf("\n== %ld filmes ==\n", count);
+    if (needed > available * 0.8) {
+        printf("ignorado: estimativa de %.0f MB excede a memória disponível (%.0f MB)\n", needed / 1048576,
+               available / 1048576);
+        return;
+    }
+
+    char dir[] = "bench-catalog-XXXXXX";
+    char cwd[4096];
+    if (!mkdtemp(dir) || !getcwd(cwd, sizeof(cwd)) || chdir(dir) != 0) {
+        perror("diretório temporário");
+        return;
+    }
+
+    double start = now_ns();
+    if (generate_catalog(count) != 0) {
+        perror("movies.json");
+    } else {
+        struct stat st;
+        stat("movies.json", &st);
+        printf("arquivo de %.1f MB gerado em %.2f s\n\n", st.st_size / 1048576.0, (now_ns() - start) / 1e9);
+        // As larguras compensam os bytes extras dos caracteres acentuados em UTF-8
+        printf("%-26s %14s %12s %14s %16s\n", "operação", "ns/op", "iterações", "pico RSS (MB)",
+               "heap retido (KB)");
+
+        catalog_size = count;
+        for (size_t i = 0; i < sizeof(operations) / sizeof(operations[0]); i++) {
+            measure(&operations[i]);
+        }
+    }
+
+    if (chdir(cwd) != 0) {
+        perror("chdir");
+    }
+    remove_workdir(dir);
+}
+
+int main(int argc, char *argv[]) {
+    long default_sizes[] = {1000, 10000, 100000};
+
+    if (argc < 2) {
+        for (size_t i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]); i++) {
+            bench_size(default_sizes[i]);
+        }
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        long count = atol(argv[i]);
+        if (count > 0) {
+            bench_size(count);
+        }
+    }
+    return 0;
+}
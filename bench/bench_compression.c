@@ -0,0 +1,162 @@
+// Benchmark da compressão de respostas: bytes enviados e custo de CPU por listagem
+//
+// Uso: bench_compression [número de filmes]
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../compression.h"
+
+static const char *genres[] = {
+    "Comédia", "Drama", "Ação", "Ficção Científica", "Terror", "Animação",
+    "Documentário", "Romance", "Suspense", "Aventura", "Fantasia", "Musical",
+};
+
+static const char *words[] = {
+    "Noite", "Cidade", "Amor", "Guerra", "Sombra", "Estrela", "Caminho",
+    "Segredo", "Tempo", "Mar", "Fogo", "Sonho", "Última", "Missão", "Rei",
+};
+
+static const char *directors[] = {
+    "Fernando Meirelles", "Walter Salles", "Kleber Mendonça Filho", "Anna Muylaert",
+    "Glauber Rocha", "José Padilha", "Petra Costa", "Hector Babenco",
+};
+
+// Tempo monotônico em nanossegundos
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Acrescenta texto formatado a um buffer que cresce conforme necessário
+static void append(char **text, size_t *length, size_t *capacity, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    while (*length + needed + 1 > *capacity) {
+        *capacity *= 2;
+        *text = realloc(*text, *capacity);
+    }
+
+    va_start(args, format);
+    vsnprintf(*text + *length, *capacity - *length, format, args);
+    va_end(args);
+    *length += needed;
+}
+
+// Gera uma listagem no mesmo formato de list_all_movies (all = 1) ou de
+// list_movies_by_genre (all = 0, apenas os filmes de Drama)
+static char *build_listing(int count, int all, size_t *length) {
+    size_t capacity = 4096;
+    char *text = malloc(capacity);
+    size_t genre_count = sizeof(genres) / sizeof(genres[0]);
+    size_t word_count = sizeof(words) / sizeof(words[0]);
+    size_t director_count = sizeof(directors) / sizeof(directors[0]);
+
+    *length = 0;
+    srand(42);
+    append(&text, length, &capacity, all ? "Lista de Filmes:\n================\n"
+                                         : "Filmes do gênero 'Drama':\n===================\n");
+
+    for (int i = 0; i < count; i++) {
+        const char *first = words[rand() % word_count];
+        const char *second = words[rand() % word_count];
+        const char *director = directors[(size_t)(rand() % director_count) * (rand() % director_count) / director_count];
+        int year = 1950 + rand() % 75;
+        size_t g1 = (size_t)(rand() % genre_count) * (rand() % genre_count) / genre_count;
+        size_t g2 = rand() % genre_count;
+        int two = rand() % 4 == 0;
+
+        if (all) {
+            append(&text, length, &capacity, "\nID: %d\nTítulo: %s da %s\nDiretor: %s\nAno: %d\nGêneros: %s", i + 1,
+                   first, second, director, year, genres[g1]);
+            if (two && g2 != g1) {
+                append(&text, length, &capacity, ", %s", genres[g2]);
+            }
+            append(&text, length, &capacity, "\n");
+        } else if (g1 == 1 || (two && g2 == 1)) {
+            append(&text, length, &capacity, "\nID: %d\nTítulo: %s da %s\nDiretor: %s\nAno: %d\n", i + 1, first,
+                   second, director, year);
+        }
+    }
+    return text;
+}
+
+// Mede uma listagem em um nível: a primeira resposta de uma conexão nova e as
+// respostas seguintes, que aproveitam o dicionário do fluxo
+static void measure(const char *name, const char *listing, size_t length, int level, int rounds) {
+    struct iovec iov = {.iov_base = (void *)listing, .iov_len = length};
+    response_compressor *compressor = response_compressor_create(level);
+    response_decompressor *decompressor = response_decompressor_create();
+    size_t first_bytes = 0, stream_bytes = 0;
+    double compress_ns = 0, decompress_ns = 0;
+    int valid = 1;
+
+    for (int r = 0; r < rounds; r++) {
+        char *frame;
+        size_t frame_length;
+        char type;
+        uint32_t payload_length, original_length;
+        char *text;
+
+        double start = now_ns();
+        response_compressor_frame(compressor, &iov, 1, &frame, &frame_length);
+        compress_ns += now_ns() - start;
+
+        compression_frame_header((unsigned char *)frame, &type, &payload_length, &original_length);
+        start = now_ns();
+        int failed = response_decompress(decompressor, type, frame + COMPRESSION_FRAME_HEADER, payload_length,
+                                         original_length, &text);
+        decompress_ns += now_ns() - start;
+
+        valid &= !failed && original_length == length && memcmp(text, listing, length) == 0;
+        if (!failed) {
+            free(text);
+        }
+
+        if (r == 0) {
+            first_bytes = frame_length;
+        } else {
+            stream_bytes += frame_length;
+        }
+        free(frame);
+    }
+
+    printf("%-10s %5d %10zu %10zu %7.2fx %10zu %12.1f %10.1f %12.1f%s\n", name, level, length, first_bytes,
+           (double)length / first_bytes, rounds > 1 ? stream_bytes / (rounds - 1) : first_bytes,
+           compress_ns / rounds / 1000, length / (compress_ns / rounds) * 1000, decompress_ns / rounds / 1000,
+           valid ? "" : "  (DIVERGENTE)");
+
+    response_compressor_free(compressor);
+    response_decompressor_free(decompressor);
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc >= 2 ? atoi(argv[1]) : 1000;
+    int rounds = 20;
+    int levels[] = {1, 6, 9};
+    size_t all_length, genre_length;
+    char *all = build_listing(count, 1, &all_length);
+    char *by_genre = build_listing(count, 0, &genre_length);
+
+    printf("%d filmes, %d rodadas; bytes no fio incluem o cabeçalho de %d bytes do quadro\n\n", count, rounds,
+           COMPRESSION_FRAME_HEADER);
+    printf("%-10s %5s %10s %10s %8s %10s %12s %10s %12s\n", "listagem", "nível", "original", "1ª resp.", "razão",
+           "seguintes", "compr. us", "MB/s", "descompr. us");
+
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        measure("todos", all, all_length, levels[i], rounds);
+    }
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        measure("gênero", by_genre, genre_length, levels[i], rounds);
+    }
+
+    free(all);
+    free(by_genre);
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Microbenchmark dos kernels de text_match.c contra o caminho com strcasecmp/strcasestr
+//
+// Uso: bench_text_match [número de filmes]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "../text_match.h"
+
+static const char *genres[] = {
+    "Comédia", "Drama", "Ação", "Ficção Científica", "Terror", "Animação",
+    "Documentário", "Romance", "Suspense", "Aventura", "Fantasia", "Musical",
+};
+
+static const char *words[] = {
+    "Noite", "Cidade", "Amor", "Guerra", "Sombra", "Estrela", "Caminho",
+    "Segredo", "Tempo", "Mar", "Fogo", "Sonho", "Última", "Missão", "Rei",
+};
+
+// Tempo monotônico em nanossegundos
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Alterna a caixa ASCII para exercitar a comparação sem diferenciar maiúsculas
+static void mix_case(char *text, int seed) {
+    for (int i = 0; text[i]; i++) {
+        if ((i + seed) % 3 == 0 && text[i] >= 'a' && text[i] <= 'z') {
+            text[i] -= 0x20;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc >= 2 ? atoi(argv[1]) : 100000;
+    int rounds = 20;
+    size_t genre_count = sizeof(genres) / sizeof(genres[0]);
+    size_t word_count = sizeof(words) / sizeof(words[0]);
+
+    // Gera títulos e gêneros sintéticos; a maioria dos filmes tem 1 ou 2 gêneros
+    char **titles = malloc(count * sizeof(char *));
+    char **movie_genres = malloc(count * 2 * sizeof(char *));
+    int *genre_counts = malloc(count * sizeof(int));
+    text_column genre_column, title_column;
+    text_column_init(&genre_column);
+    text_column_init(&title_column);
+    srand(42);
+
+    for (int i = 0; i < count; i++) {
+        char title[256];
+        snprintf(title, sizeof(title), "A %s da %s %s %d", words[rand() % word_count],
+                 words[rand() % word_count], words[rand() % word_count], i);
+        titles[i] = strdup(title);
+        text_column_add(&title_column, titles[i], i);
+
+        genre_counts[i] = 1 + (rand() % 4 == 0);
+        for (int g = 0; g < genre_counts[i]; g++) {
+            // Distribuição enviesada: os primeiros gêneros são bem mais frequentes
+            size_t pick = (size_t)(rand() % genre_count) * (rand() % genre_count) / genre_count;
+            char *genre = strdup(genres[pick]);
+            mix_case(genre, i + g);
+            movie_genres[i * 2 + g] = genre;
+            text_column_add(&genre_column, genre, i);
+        }
+    }
+
+    const char *genre_query = "drama";
+    const char *title_query = "sombra da";
+    unsigned char *matches = calloc(count, 1);
+    double start, elapsed;
+    size_t expected_genre = 0, expected_title = 0;
+
+    printf("%d filmes, %zu gêneros, %d rodadas\n\n", count, genre_column.count, rounds);
+    printf("%-28s %12s %12s\n", "caminho", "ns/valor", "encontrados");
+
+    // Caminho atual: strcasecmp por gênero
+    start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        expected_genre = 0;
+        for (int i = 0; i < count; i++) {
+            for (int g = 0; g < genre_counts[i]; g++) {
+                if (strcasecmp(movie_genres[i * 2 + g], genre_query) == 0) {
+                    expected_genre++;
+                    break;
+                }
+            }
+        }
+    }
+    elapsed = now_ns() - start;
+    printf("%-28s %12.2f %12zu\n", "gênero strcasecmp", elapsed / rounds / genre_column.count, expected_genre);
+
+    // Caminho sem kernel: strcasestr por título
+    start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        expected_title = 0;
+        for (int i = 0; i < count; i++) {
+            if (strcasestr(titles[i], title_query)) {
+                expected_title++;
+            }
+        }
+    }
+    elapsed = now_ns() - start;
+    printf("%-28s %12.2f %12zu\n", "título strcasestr", elapsed / rounds / count, expected_title);
+
+    // Kernels de text_match.c em cada implementação suportada
+    const char *implementations[] = {"scalar", "sse2", "avx2"};
+    for (size_t k = 0; k < 3; k++) {
+        if (text_match_select(implementations[k]) != 0) {
+            printf("%-28s %12s\n", implementations[k], "não suportado");
+            continue;
+        }
+
+        text_pattern pattern;
+        text_pattern_init(&pattern, genre_query);
+        size_t found = 0;
+        start = now_ns();
+        for (int r = 0; r < rounds; r++) {
+            memset(matches, 0, count);
+            found = text_column_match_equals(&genre_column, &pattern, matches);
+        }
+        elapsed = now_ns() - start;
+        text_pattern_free(&pattern);
+
+        char label[64];
+        snprintf(label, sizeof(label), "gênero %s", implementations[k]);
+        printf("%-28s %12.2f %12zu%s\n", label, elapsed / rounds / genre_column.count, found,
+               found == expected_genre ? "" : "  (DIVERGENTE)");
+
+        text_pattern_init(&pattern, title_query);
+        start = now_ns();
+        for (int r = 0; r < rounds; r++) {
+            memset(matches, 0, count);
+            found = text_column_match_contains(&title_column, &pattern, matches);
+        }
+        elapsed = now_ns() - start;
+        text_pattern_free(&pattern);
+
+        snprintf(label, sizeof(label), "título %s", implementations[k]);
+        printf("%-28s %12.2f %12zu%s\n", label, elapsed / rounds / count, found,
+               found == expected_title ? "" : "  (DIVERGENTE)");
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(titles[i]);
+        for (int g = 0; g < genre_counts[i]; g++) {
+            free(movie_genres[i * 2 + g]);
+        }
+    }
+    free(titles);
+    free(movie_genres);
+    free(genre_counts);
+    free(matches);
+    text_column_free(&genre_column);
+    text_column_free(&title_column);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "catalog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// A versão atual é indicada por uma palavra de 64 bits: os 16 bits altos trazem a
+// posição da versão em slots (mais 1; 0 indica nenhuma) e os 48 baixos contam
+// quantas vezes ela foi obtida. Um leitor obtém a versão e registra a referência
+// com um único fetch_add, sem nunca esperar; ao trocar a versão, o escritor soma
+// essa contagem às devoluções já feitas, e a versão é liberada quando o saldo zera.
+#define SLOT_SHIFT 48
+#define COUNT_MASK ((UINT64_C(1) << SLOT_SHIFT) - 1)
+
+static catalog_version *slots[CATALOG_MAX_VERSIONS];
+static uint64_t current = 0;
+static uint64_t last_number = 0;
+
+// Libera uma versão que não tem mais leitores
+static void destroy(catalog_version *version) {
+    for (int i = 0; i < CATALOG_COLUMNS; i++) {
+        if (version->columns[i]) {
+            text_column_free(version->columns[i]);
+            free(version->columns[i]);
+        }
+    }
+    json_decref(version->root);
+    __atomic_store_n(&slots[version->slot], NULL, __ATOMIC_RELEASE);
+    free(version);
+}
+
+// Obtém a versão atual sem bloqueio
+catalog_version *catalog_acquire() {
+    uint64_t word = __atomic_fetch_add(&current, 1, __ATOMIC_ACQ_REL);
+    int slot = (int)(word >> SLOT_SHIFT);
+    if (slot == 0) {
+        return NULL;
+    }
+    return __atomic_load_n(&slots[slot - 1], __ATOMIC_ACQUIRE);
+}
+
+// Devolve uma versão; enquanto ela é a atual, o saldo fica negativo ou zero
+void catalog_release(catalog_version *version) {
+    if (__atomic_sub_fetch(&version->references, 1, __ATOMIC_ACQ_REL) == 0) {
+        destroy(version);
+    }
+}
+
+// Obtém uma coluna da versão. Consultas simultâneas podem montá-la ao mesmo tempo:
+// a primeira a terminar a instala e as demais descartam a sua, sem bloqueio.
+const text_column *catalog_column(catalog_version *version, catalog_column_kind kind, catalog_column_builder build) {
+    text_column *column = __atomic_load_n(&version->columns[kind], __ATOMIC_ACQUIRE);
+    if (column) {
+        return column;
+    }
+
+    text_column *built = malloc(sizeof(text_column));
+    if (!built) {
+        return NULL;
+    }
+    text_column_init(built);
+    if (build(version->root, kind, built) != 0) {
+        text_column_free(built);
+        free(built);
+        return NULL;
+    }
+
+    if (!__atomic_compare_exchange_n(&version->columns[kind], &column, built, 0, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE)) {
+        text_column_free(built);
+        free(built);
+        return column;
+    }
+    return built;
+}
+
+// Reserva uma posição livre; retorna -1 se todas estiverem ocupadas por versões
+// antigas ainda em uso. O escritor não espera: ele mantém db_mutex bloqueado, e
+// esperar deteria todas as escritas e recargas até um leitor devolver sua versão.
+static int reserve_slot(catalog_version *version) {
+    for (int i = 0; i < CATALOG_MAX_VERSIONS; i++) {
+        if (!__atomic_load_n(&slots[i], __ATOMIC_ACQUIRE)) {
+            version->slot = i;
+            __atomic_store_n(&slots[i], version, __ATOMIC_RELEASE);
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Só os escritores ocupam posições, um por vez; os leitores apenas as liberam. Uma
+// posição livre encontrada aqui continua livre até a próxima publicação.
+int catalog_can_publish() {
+    for (int i = 0; i < CATALOG_MAX_VERSIONS; i++) {
+        if (!__atomic_load_n(&slots[i], __ATOMIC_ACQUIRE)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Publica uma nova versão e aposenta a anterior
+uint64_t catalog_publish(json_t *root, const struct stat *file) {
+    catalog_version *version = malloc(sizeof(catalog_version));
+    if (!version) {
+        json_decref(root);
+        return 0;
+    }
+
+    version->root = root;
+    version->file = *file;
+    version->references = 0;
+    for (int i = 0; i < CATALOG_COLUMNS; i++) {
+        version->columns[i] = NULL;
+    }
+
+    int slot = reserve_slot(version);
+    if (slot < 0) {
+        fprintf(stderr, "Erro: todas as %d versões do catálogo estão em uso por leitores\n", CATALOG_MAX_VERSIONS);
+        json_decref(root);
+        free(version);
+        return 0;
+    }
+    version->number = ++last_number;
+    uint64_t previous = __atomic_exchange_n(&current, (uint64_t)(slot + 1) << SLOT_SHIFT, __ATOMIC_ACQ_REL);
+
+    int previous_slot = (int)(previous >> SLOT_SHIFT);
+    if (previous_slot != 0) {
+        catalog_version *retired = __atomic_load_n(&slots[previous_slot - 1], __ATOMIC_ACQUIRE);
+        int64_t acquired = (int64_t)(previous & COUNT_MASK);
+        if (__atomic_add_fetch(&retired->references, acquired, __ATOMIC_ACQ_REL) == 0) {
+            destroy(retired);
+        }
+    }
+    return version->number;
+}
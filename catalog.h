@@ -0,0 +1,56 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <jansson.h>
+#include "text_match.h"
+
+// Número máximo de versões vivas ao mesmo tempo (a atual e as ainda em uso por leitores)
+#define CATALOG_MAX_VERSIONS 64
+
+// Colunas de busca de uma versão, com os valores de todos os filmes de forma contígua
+typedef enum {
+    CATALOG_COLUMN_TITLE,
+    CATALOG_COLUMN_GENRE,
+    CATALOG_COLUMN_DIRECTOR,
+} catalog_column_kind;
+
+#define CATALOG_COLUMNS 3
+
+// Versão imutável do catálogo residente em memória. Escritas e recargas publicam
+// uma nova versão; leitores em andamento terminam na versão que obtiveram, que só
+// é liberada quando o último deles a devolve. As versões compartilham os filmes
+// não alterados, o que exige a contagem de referências atômica do jansson (>= 2.11).
+typedef struct {
+    json_t *root;
+    uint64_t number;
+    struct stat file;
+    int64_t references;
+    int slot;
+    text_column *columns[CATALOG_COLUMNS];
+} catalog_version;
+
+// Obtém a versão atual sem bloqueio; retorna NULL se nenhuma foi publicada
+catalog_version *catalog_acquire();
+
+// Devolve uma versão obtida com catalog_acquire
+void catalog_release(catalog_version *version);
+
+// Monta uma coluna a partir do conteúdo de uma versão; retorna -1 se faltar memória
+typedef int (*catalog_column_builder)(json_t *root, catalog_column_kind kind, text_column *column);
+
+// Obtém uma coluna de busca da versão, montada por build na primeira consulta que a
+// usa e reaproveitada pelas seguintes; retorna NULL se faltar memória
+const text_column *catalog_column(catalog_version *version, catalog_column_kind kind, catalog_column_builder build);
+
+// Publica root (assumindo sua posse) como a versão atual, associada ao arquivo file.
+// Apenas um escritor por vez pode publicar. Retorna o número da versão, ou 0 se faltar
+// memória ou se todas as CATALOG_MAX_VERSIONS versões ainda estiverem em uso.
+uint64_t catalog_publish(json_t *root, const struct stat *file);
+
+// Indica se há posição para publicar uma nova versão; chamada pelo escritor, antes de
+// gravar o arquivo, para recusar a escrita em vez de gravar o que não será publicado
+int catalog_can_publish();
+
+#endif
@@ -2,10 +2,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
+#include "shm_ring.h"
+#include "compression.h"
 
 #define BUFFER_SIZE 4096
+#define SOCKET_PATH "/tmp/movies.sock"
 
 void display_menu()
 {
@@ -17,56 +22,362 @@ void display_menu()
     printf("5. Listar informações de todos os filmes\n");
     printf("6. Listar informações de um filme específico\n");
     printf("7. Listar todos os filmes de um determinado gênero\n");
+    printf("8. Executar várias operações em uma transação\n");
+    printf("9. Buscar filmes pelo título\n");
+    printf("10. Listar gêneros, diretores ou décadas com mais filmes\n");
+    printf("11. Contar os filmes de um gênero, diretor ou década\n");
     printf("0. Sair\n");
     printf("Escolha uma opção: ");
 }
 
-int main(int argc, char *argv[])
+// Conecta ao servidor por um socket Unix
+int connect_unix(const char *path)
 {
-    int sock = 0;
-    struct sockaddr_in serv_addr;
-    char buffer[BUFFER_SIZE] = {0};
-    char server_ip[16] = "127.0.0.1"; // Endereço IP padrão (localhost)
-    int port = 49153;                 // Porta não reservada
+    struct sockaddr_un addr;
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+    {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
 
-    // Verifica se foi fornecido um endereço IP
-    if (argc >= 2)
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
     {
-        strcpy(server_ip, argv[1]);
+        close(sock);
+        return -1;
     }
+    return sock;
+}
 
-    // Verifica se foi fornecida uma porta
-    if (argc >= 3)
+// Verifica, durante as esperas no canal de memória compartilhada, se o servidor continua ativo
+int server_alive(void *context)
+{
+    struct pollfd pfd = {.fd = *((int *)context), .events = POLLIN, .revents = 0};
+    poll(&pfd, 1, 0);
+    return !(pfd.revents & (POLLIN | POLLHUP | POLLERR));
+}
+
+// Negocia o canal de memória compartilhada: o servidor envia um memfd pelo socket Unix
+shm_channel *connect_shm(int sock)
+{
+    char payload[128] = {0};
+    struct iovec iov = {.iov_base = payload, .iov_len = sizeof(payload) - 1};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    if (recvmsg(sock, &msg, 0) <= 0)
     {
-        port = atoi(argv[2]);
+        return NULL;
     }
 
-    // Cria o socket
-    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
     {
-        printf("\nErro ao criar socket\n");
-        return -1;
+        // Sem descritor, o servidor enviou uma mensagem de erro
+        printf("\n%s\n", payload);
+        return NULL;
     }
 
-    // Configura o endereço do servidor
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port);
+    int memfd;
+    memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+    shm_channel *channel = shm_channel_map(memfd);
+    close(memfd);
 
-    // Converte o endereço IP de texto para binário
-    if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0)
+    if (channel && (channel->magic != SHM_CHANNEL_MAGIC || channel->capacity != SHM_RING_CAPACITY))
     {
-        printf("\nEndereço inválido / Endereço não suportado\n");
-        return -1;
+        shm_channel_unmap(channel);
+        return NULL;
     }
+    return channel;
+}
 
-    // Conecta ao servidor
-    if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+// Envia uma mensagem ao servidor pelo transporte em uso; toda requisição termina em '\n'
+int send_message(int sock, shm_channel *channel, const char *message)
+{
+    size_t length = strlen(message);
+
+    if (channel)
+    {
+        if (shm_ring_begin_message(&channel->request, length + 1, server_alive, &sock) != 0 ||
+            shm_ring_write(&channel->request, message, length, server_alive, &sock) != 0)
+        {
+            return -1;
+        }
+        return shm_ring_write(&channel->request, "\n", 1, server_alive, &sock);
+    }
+    if (send(sock, message, length, MSG_MORE) < 0)
     {
-        printf("\nConexão falhou\n");
         return -1;
     }
+    return send(sock, "\n", 1, 0) < 0 ? -1 : 0;
+}
+
+// Lê exatamente length bytes do socket
+int recv_exact(int sock, char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t received = recv(sock, data, length, 0);
+        if (received <= 0)
+        {
+            return -1;
+        }
+        data += received;
+        length -= received;
+    }
+    return 0;
+}
+
+// Recebe uma resposta sem compressão, que termina em '\0'. Só os bytes até o
+// terminador são consumidos, para que o início da resposta seguinte fique no socket.
+char *receive_text(int sock)
+{
+    size_t length = 0;
+    size_t capacity = BUFFER_SIZE;
+    char *message = malloc(capacity);
+
+    while (message)
+    {
+        if (capacity - length < BUFFER_SIZE)
+        {
+            capacity *= 2;
+            char *grown = realloc(message, capacity);
+            if (!grown)
+            {
+                break;
+            }
+            message = grown;
+        }
+
+        ssize_t peeked = recv(sock, message + length, BUFFER_SIZE - 1, MSG_PEEK);
+        if (peeked <= 0)
+        {
+            // Uma resposta sem terminador seguida do fim da conexão (ex.: servidor lotado)
+            if (length > 0)
+            {
+                message[length] = '\0';
+                return message;
+            }
+            break;
+        }
+
+        char *end = memchr(message + length, '\0', peeked);
+        size_t take = end ? (size_t)(end - (message + length)) + 1 : (size_t)peeked;
+        if (recv_exact(sock, message + length, take) != 0)
+        {
+            break;
+        }
+        length += take;
+
+        if (end)
+        {
+            return message;
+        }
+    }
+
+    free(message);
+    return NULL;
+}
+
+// Recupera o texto de um quadro da compressão (cabeçalho seguido do conteúdo)
+char *decode_frame(response_decompressor *decompressor, const char *frame, size_t length)
+{
+    char type;
+    uint32_t payload_length;
+    uint32_t original_length;
+    char *text;
+
+    if (length < COMPRESSION_FRAME_HEADER ||
+        compression_frame_header((const unsigned char *)frame, &type, &payload_length, &original_length) != 0 ||
+        length - COMPRESSION_FRAME_HEADER != payload_length)
+    {
+        return NULL;
+    }
+    if (response_decompress(decompressor, type, frame + COMPRESSION_FRAME_HEADER, payload_length,
+                            original_length, &text) != 0)
+    {
+        return NULL;
+    }
+    return text;
+}
+
+// Recebe uma resposta do servidor (memória alocada, terminada em '\0'); retorna NULL
+// se a conexão foi perdida. Com a compressão ativa, cada resposta chega em um quadro.
+char *receive_response(int sock, shm_channel *channel, response_decompressor *decompressor)
+{
+    char *message;
+    size_t length;
+
+    if (channel)
+    {
+        // Pela memória compartilhada a resposta chega inteira, com o tamanho no cabeçalho
+        if (shm_ring_receive(&channel->response, &message, &length, UINT32_MAX, server_alive, &sock) != 0)
+        {
+            return NULL;
+        }
+        if (decompressor)
+        {
+            char *text = decode_frame(decompressor, message, length);
+            free(message);
+            return text;
+        }
+        return message;
+    }
+
+    if (!decompressor)
+    {
+        return receive_text(sock);
+    }
+
+    char header[COMPRESSION_FRAME_HEADER];
+    char type;
+    uint32_t payload_length;
+    uint32_t original_length;
+
+    if (recv_exact(sock, header, sizeof(header)) != 0 ||
+        compression_frame_header((unsigned char *)header, &type, &payload_length, &original_length) != 0)
+    {
+        return NULL;
+    }
+
+    char *frame = malloc(sizeof(header) + payload_length);
+    if (!frame || recv_exact(sock, frame + sizeof(header), payload_length) != 0)
+    {
+        free(frame);
+        return NULL;
+    }
+    memcpy(frame, header, sizeof(header));
+
+    char *text = decode_frame(decompressor, frame, sizeof(header) + payload_length);
+    free(frame);
+    return text;
+}
+
+int main(int argc, char *argv[])
+{
+    int sock = 0;
+    struct sockaddr_in serv_addr;
+    char server_ip[16] = "127.0.0.1"; // Endereço IP padrão (localhost)
+    int port = 49153;                 // Porta não reservada
+    shm_channel *channel = NULL;
+    response_decompressor *decompressor = NULL;
+
+    // A opção -z pede ao servidor que comprima as respostas; os demais argumentos
+    // são o destino e a porta
+    const char *args[2] = {NULL, NULL};
+    int arg_count = 0;
+    int compress = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-z") == 0)
+        {
+            compress = 1;
+        }
+        else if (arg_count < 2)
+        {
+            args[arg_count++] = argv[i];
+        }
+    }
+
+    // Na mesma máquina é possível usar um socket Unix ("unix" ou "unix:caminho")
+    // ou memória compartilhada ("shm") em vez do endereço IPv4
+    if (arg_count >= 1 && strncmp(args[0], "unix", 4) == 0)
+    {
+        const char *path = args[0][4] == ':' ? args[0] + 5 : SOCKET_PATH;
+        if ((sock = connect_unix(path)) < 0)
+        {
+            printf("\nConexão falhou\n");
+            return -1;
+        }
+        printf("Conectado ao servidor em %s\n", path);
+    }
+    else if (arg_count >= 1 && strcmp(args[0], "shm") == 0)
+    {
+        if ((sock = connect_unix(SHM_SOCKET_PATH)) < 0 || !(channel = connect_shm(sock)))
+        {
+            printf("\nConexão falhou\n");
+            return -1;
+        }
+        printf("Conectado ao servidor por memória compartilhada\n");
+    }
+    else
+    {
+        // Verifica se foi fornecido um endereço IP
+        if (arg_count >= 1)
+        {
+            strncpy(server_ip, args[0], sizeof(server_ip) - 1);
+        }
+
+        // Verifica se foi fornecida uma porta
+        if (arg_count >= 2)
+        {
+            port = atoi(args[1]);
+        }
+
+        // Cria o socket
+        if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        {
+            printf("\nErro ao criar socket\n");
+            return -1;
+        }
+
+        // Configura o endereço do servidor
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_port = htons(port);
+
+        // Converte o endereço IP de texto para binário
+        if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0)
+        {
+            printf("\nEndereço inválido / Endereço não suportado\n");
+            return -1;
+        }
+
+        // Conecta ao servidor
+        if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+        {
+            printf("\nConexão falhou\n");
+            return -1;
+        }
+
+        printf("Conectado ao servidor %s:%d\n", server_ip, port);
+    }
+
+    // Negocia a compressão; a resposta da negociação ainda vem sem quadro
+    if (compress)
+    {
+        char *reply = NULL;
+        if (send_message(sock, channel, "compress;" COMPRESSION_ALGORITHM) != 0 ||
+            !(reply = receive_response(sock, channel, NULL)))
+        {
+            printf("\nConexão com o servidor perdida\n");
+            return -1;
+        }
 
-    printf("Conectado ao servidor %s:%d\n", server_ip, port);
+        printf("%s\n", reply);
+        if (strncmp(reply, "Compressão ativada", strlen("Compressão ativada")) == 0)
+        {
+            decompressor = response_decompressor_create();
+        }
+        free(reply);
+
+        if (!decompressor)
+        {
+            printf("\nNão foi possível ativar a compressão\n");
+            return -1;
+        }
+    }
 
     int option;
     char message[BUFFER_SIZE];
@@ -82,7 +393,7 @@ int main(int argc, char *argv[])
         {
             // Sair
             strcpy(message, "exit");
-            send(sock, message, strlen(message), 0);
+            send_message(sock, channel, message);
             break;
         }
 
@@ -179,20 +490,108 @@ int main(int argc, char *argv[])
             sprintf(message, "7;%s", genre);
             break;
         }
+        case 8:
+        {
+            // Agrupa várias operações de escrita em uma única transação
+            char operation[BUFFER_SIZE];
+            int count = 0;
+
+            printf("Digite uma operação por linha, no formato do protocolo:\n");
+            printf("  1;título;gêneros;diretor;ano | 2;id;gênero | 3;id\n");
+            printf("Use $n como ID para referenciar o filme cadastrado pela n-ésima operação.\n");
+            printf("Linha vazia para enviar.\n");
+
+            strcpy(message, "8;");
+            while (fgets(operation, sizeof(operation), stdin))
+            {
+                operation[strcspn(operation, "\n")] = 0;
+                if (operation[0] == '\0')
+                {
+                    break;
+                }
+                if (strlen(message) + strlen(operation) + 2 >= BUFFER_SIZE)
+                {
+                    printf("Transação muito grande, operação ignorada\n");
+                    continue;
+                }
+                if (count++ > 0)
+                {
+                    strcat(message, "|");
+                }
+                strcat(message, operation);
+            }
+            break;
+        }
+        case 9:
+        {
+            // Buscar filmes por parte do título
+            char text[256];
+
+            printf("Texto a procurar no título: ");
+            fgets(text, sizeof(text), stdin);
+            text[strcspn(text, "\n")] = 0;
+
+            // Formata a mensagem
+            sprintf(message, "9;%s", text);
+            break;
+        }
+        case 10:
+        {
+            // Listar as chaves com mais filmes
+            char dimension[32];
+            int limit;
+
+            printf("Dimensão (genero, diretor ou decada): ");
+            fgets(dimension, sizeof(dimension), stdin);
+            dimension[strcspn(dimension, "\n")] = 0;
+
+            printf("Quantidade (0 para todos): ");
+            scanf("%d", &limit);
+            getchar(); // Consome o caractere de nova linha
+
+            // Formata a mensagem
+            sprintf(message, "10;%s;%d", dimension, limit);
+            break;
+        }
+        case 11:
+        {
+            // Contar os filmes de um gênero, diretor ou década
+            char dimension[32];
+            char value[256];
+
+            printf("Dimensão (genero, diretor ou decada): ");
+            fgets(dimension, sizeof(dimension), stdin);
+            dimension[strcspn(dimension, "\n")] = 0;
+
+            printf("Valor: ");
+            fgets(value, sizeof(value), stdin);
+            value[strcspn(value, "\n")] = 0;
+
+            // Formata a mensagem
+            sprintf(message, "11;%s;%s", dimension, value);
+            break;
+        }
         default:
             printf("Opção inválida!\n");
             continue;
         }
 
         // Envia a mensagem ao servidor
-        send(sock, message, strlen(message), 0);
-
-        // Limpa o buffer
-        memset(buffer, 0, BUFFER_SIZE);
+        if (send_message(sock, channel, message) != 0)
+        {
+            printf("\nConexão com o servidor perdida\n");
+            break;
+        }
 
         // Recebe a resposta do servidor
-        read(sock, buffer, BUFFER_SIZE);
-        printf("\n%s\n", buffer);
+        char *response = receive_response(sock, channel, decompressor);
+        if (!response)
+        {
+            printf("\nConexão com o servidor perdida\n");
+            break;
+        }
+        printf("\n%s\n", response);
+        free(response);
 
         // Aguarda o usuário pressionar Enter para continuar
         printf("\nPressione Enter para continuar...");
@@ -200,6 +599,11 @@ int main(int argc, char *argv[])
     }
 
     // Fecha o socket
+    response_decompressor_free(decompressor);
+    if (channel)
+    {
+        shm_channel_unmap(channel);
+    }
     close(sock);
     printf("Conexão encerrada\n");
 
@@ -0,0 +1,191 @@
+#include "compression.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+struct response_compressor {
+    z_stream stream;
+};
+
+struct response_decompressor {
+    z_stream stream;
+};
+
+// Grava um inteiro de 32 bits em big-endian
+static void put_u32(unsigned char *out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+static uint32_t get_u32(const unsigned char *in) {
+    return (uint32_t)in[0] << 24 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 8 | in[3];
+}
+
+// Cria o compressor com deflate sem cabeçalho zlib (o quadro já identifica o conteúdo)
+response_compressor *response_compressor_create(int level) {
+    response_compressor *compressor = calloc(1, sizeof(response_compressor));
+    if (!compressor) {
+        return NULL;
+    }
+    if (deflateInit2(&compressor->stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(compressor);
+        return NULL;
+    }
+    return compressor;
+}
+
+void response_compressor_free(response_compressor *compressor) {
+    if (compressor) {
+        deflateEnd(&compressor->stream);
+        free(compressor);
+    }
+}
+
+// Monta o quadro de uma resposta
+int response_compressor_frame(response_compressor *compressor, const struct iovec *iov, int iovcnt,
+                              char **frame, size_t *frame_length) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    if (total > UINT32_MAX) {
+        return -1;
+    }
+
+    // Respostas pequenas seguem sem compressão e não passam pelo fluxo
+    if (total < COMPRESSION_THRESHOLD) {
+        char *data = malloc(COMPRESSION_FRAME_HEADER + total);
+        if (!data) {
+            return -1;
+        }
+
+        data[0] = COMPRESSION_FRAME_RAW;
+        put_u32((unsigned char *)data + 1, total);
+        put_u32((unsigned char *)data + 5, total);
+
+        size_t offset = COMPRESSION_FRAME_HEADER;
+        for (int i = 0; i < iovcnt; i++) {
+            memcpy(data + offset, iov[i].iov_base, iov[i].iov_len);
+            offset += iov[i].iov_len;
+        }
+
+        *frame = data;
+        *frame_length = offset;
+        return 0;
+    }
+
+    // deflateBound vale para um bloco isolado; a folga cobre o marcador do Z_SYNC_FLUSH
+    z_stream *stream = &compressor->stream;
+    size_t capacity = COMPRESSION_FRAME_HEADER + deflateBound(stream, total) + 64;
+    char *data = malloc(capacity);
+    if (!data) {
+        return -1;
+    }
+
+    stream->next_out = (Bytef *)data + COMPRESSION_FRAME_HEADER;
+    stream->avail_out = capacity - COMPRESSION_FRAME_HEADER;
+
+    for (int i = 0; i <= iovcnt; i++) {
+        int last = i == iovcnt;
+        stream->next_in = last ? Z_NULL : (Bytef *)iov[i].iov_base;
+        stream->avail_in = last ? 0 : iov[i].iov_len;
+
+        // Cada trecho é consumido por inteiro; o último passo apenas esvazia o fluxo
+        do {
+            if (stream->avail_out == 0) {
+                size_t used = (char *)stream->next_out - data;
+                char *grown = realloc(data, capacity * 2);
+                if (!grown) {
+                    free(data);
+                    return -1;
+                }
+                data = grown;
+                capacity *= 2;
+                stream->next_out = (Bytef *)data + used;
+                stream->avail_out = capacity - used;
+            }
+
+            int result = deflate(stream, last ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+            if (result != Z_OK && result != Z_BUF_ERROR) {
+                free(data);
+                return -1;
+            }
+        } while (stream->avail_in > 0 || (last && stream->avail_out == 0));
+    }
+
+    size_t length = (char *)stream->next_out - data;
+    data[0] = COMPRESSION_FRAME_DEFLATE;
+    put_u32((unsigned char *)data + 1, length - COMPRESSION_FRAME_HEADER);
+    put_u32((unsigned char *)data + 5, total);
+
+    *frame = data;
+    *frame_length = length;
+    return 0;
+}
+
+// Cria o descompressor correspondente
+response_decompressor *response_decompressor_create() {
+    response_decompressor *decompressor = calloc(1, sizeof(response_decompressor));
+    if (!decompressor) {
+        return NULL;
+    }
+    if (inflateInit2(&decompressor->stream, -15) != Z_OK) {
+        free(decompressor);
+        return NULL;
+    }
+    return decompressor;
+}
+
+void response_decompressor_free(response_decompressor *decompressor) {
+    if (decompressor) {
+        inflateEnd(&decompressor->stream);
+        free(decompressor);
+    }
+}
+
+// Lê o cabeçalho de um quadro
+int compression_frame_header(const unsigned char *header, char *type, uint32_t *payload_length,
+                             uint32_t *original_length) {
+    *type = header[0];
+    *payload_length = get_u32(header + 1);
+    *original_length = get_u32(header + 5);
+
+    if (*type == COMPRESSION_FRAME_RAW) {
+        return *payload_length == *original_length ? 0 : -1;
+    }
+    return *type == COMPRESSION_FRAME_DEFLATE ? 0 : -1;
+}
+
+// Recupera o texto de um quadro
+int response_decompress(response_decompressor *decompressor, char type, const char *payload,
+                        uint32_t payload_length, uint32_t original_length, char **text) {
+    char *data = malloc((size_t)original_length + 1);
+    if (!data) {
+        return -1;
+    }
+
+    if (type == COMPRESSION_FRAME_RAW) {
+        memcpy(data, payload, payload_length);
+    } else {
+        z_stream *stream = &decompressor->stream;
+        stream->next_in = (Bytef *)payload;
+        stream->avail_in = payload_length;
+        stream->next_out = (Bytef *)data;
+        stream->avail_out = original_length + 1;
+
+        // Com o Z_SYNC_FLUSH do servidor, o quadro contém exatamente a resposta; o byte
+        // extra de saída garante que o marcador final do quadro também seja consumido
+        int result = inflate(stream, Z_SYNC_FLUSH);
+        if ((result != Z_OK && result != Z_BUF_ERROR) || stream->avail_out != 1 || stream->avail_in != 0) {
+            free(data);
+            return -1;
+        }
+    }
+
+    data[original_length] = '\0';
+    *text = data;
+    return 0;
+}
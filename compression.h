@@ -0,0 +1,52 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// Depois que o cliente negocia a compressão, cada resposta é enviada em um quadro:
+// 1 byte de tipo, 4 bytes com o tamanho do conteúdo e 4 bytes com o tamanho original
+// (inteiros big-endian). Respostas a partir de COMPRESSION_THRESHOLD bytes são
+// comprimidas com deflate em um fluxo contínuo por conexão, encerrado em cada
+// resposta com Z_SYNC_FLUSH, de modo que o dicionário das respostas anteriores
+// continua valendo para as seguintes.
+#define COMPRESSION_FRAME_HEADER 9
+#define COMPRESSION_FRAME_RAW 'R'
+#define COMPRESSION_FRAME_DEFLATE 'Z'
+
+// Respostas menores que isto não compensam a compressão
+#define COMPRESSION_THRESHOLD 512
+
+// Nível do deflate usado pelo servidor (priorizando a CPU)
+#define COMPRESSION_LEVEL 1
+
+// Nome do algoritmo aceito na negociação ("compress;deflate")
+#define COMPRESSION_ALGORITHM "deflate"
+
+typedef struct response_compressor response_compressor;
+typedef struct response_decompressor response_decompressor;
+
+// Cria e libera o compressor de uma conexão (NULL se faltar memória)
+response_compressor *response_compressor_create(int level);
+void response_compressor_free(response_compressor *compressor);
+
+// Monta o quadro de uma resposta formada por iovcnt trechos, comprimindo-a se
+// passar do limiar; o quadro é alocado e entregue em frame. Retorna -1 em caso
+// de erro, após o qual o fluxo não pode mais ser usado.
+int response_compressor_frame(response_compressor *compressor, const struct iovec *iov, int iovcnt,
+                              char **frame, size_t *frame_length);
+
+// Cria e libera o descompressor do cliente
+response_decompressor *response_decompressor_create();
+void response_decompressor_free(response_decompressor *decompressor);
+
+// Lê o cabeçalho de um quadro; retorna -1 se o tipo for desconhecido
+int compression_frame_header(const unsigned char *header, char *type, uint32_t *payload_length,
+                             uint32_t *original_length);
+
+// Recupera o texto de um quadro (memória alocada, terminada em '\0'); retorna -1 em caso de erro
+int response_decompress(response_decompressor *decompressor, char type, const char *payload,
+                        uint32_t payload_length, uint32_t original_length, char **text);
+
+#endif
@@ -0,0 +1,333 @@
+#define _GNU_SOURCE
+#include "connection.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+// Número de clientes conectados no momento
+static int active_connections = 0;
+
+// Roda de temporização das conexões ociosas, protegida por idle_mutex
+static timer_wheel idle_wheel;
+static pthread_mutex_t idle_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Limites de requisições de clientes remotos, por endereço, e de clientes locais
+static peer_limiter remote_limiter = PEER_LIMITER_INITIALIZER(RATE_LIMIT_PER_SECOND, RATE_LIMIT_BURST);
+static peer_limiter local_limiter = PEER_LIMITER_INITIALIZER(LOCAL_RATE_LIMIT_PER_SECOND, LOCAL_RATE_LIMIT_BURST);
+
+// Converte milissegundos para ticks da roda
+static uint64_t to_tick(uint64_t ms) {
+    return ms / IDLE_TICK_MS;
+}
+
+// Obtém o tempo monotônico atual em milissegundos
+uint64_t monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Reserva uma vaga se ainda houver espaço para mais um cliente
+int connection_slot_acquire() {
+    int current = __atomic_load_n(&active_connections, __ATOMIC_RELAXED);
+    do {
+        if (current >= MAX_CONNECTIONS) {
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&active_connections, &current, current + 1, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    return 0;
+}
+
+// Libera a vaga de um cliente desconectado
+void connection_slot_release() {
+    __atomic_sub_fetch(&active_connections, 1, __ATOMIC_ACQ_REL);
+}
+
+// Aguarda até que todos os clientes se desconectem; retorna -1 se o prazo se esgotar
+int connection_wait_all(int timeout_ms) {
+    uint64_t deadline = monotonic_ms() + timeout_ms;
+    struct timespec interval = {0, 50 * 1000000L};
+
+    while (__atomic_load_n(&active_connections, __ATOMIC_ACQUIRE) > 0) {
+        if (monotonic_ms() >= deadline) {
+            return -1;
+        }
+        nanosleep(&interval, NULL);
+    }
+    return 0;
+}
+
+// Verifica se há um servidor atendendo no caminho; só um arquivo que recusa conexões é abandonado
+static int unix_path_in_use(const struct sockaddr_un *address) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return 0;
+    }
+
+    int in_use = connect(fd, (const struct sockaddr *)address, sizeof(*address)) == 0 || errno != ECONNREFUSED;
+    close(fd);
+    return in_use;
+}
+
+// Cria um socket Unix de escuta
+int unix_listen(const char *path, struct stat *bound) {
+    struct sockaddr_un address;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    // Um arquivo deixado por uma execução anterior impediria o bind, mas o de outro
+    // servidor em execução não pode ser removido: os clientes dele perderiam o caminho
+    struct stat existing;
+    if (lstat(path, &existing) == 0) {
+        if (unix_path_in_use(&address)) {
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, LISTEN_BACKLOG) < 0 ||
+        lstat(path, bound) != 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+    return fd;
+}
+
+// Remove o arquivo do socket, a menos que outro servidor já o tenha substituído
+void unix_unlink(const char *path, const struct stat *bound) {
+    struct stat current;
+    if (lstat(path, &current) == 0 && current.st_dev == bound->st_dev && current.st_ino == bound->st_ino) {
+        unlink(path);
+    }
+}
+
+// Chamado pela roda quando o prazo de uma conexão vence
+static void idle_expired(timer_entry *entry, void *context) {
+    timer_wheel *wheel = context;
+    connection *conn = (connection *)((char *)entry - offsetof(connection, idle_timer));
+    uint64_t last_activity = __atomic_load_n(&conn->last_activity_ms, __ATOMIC_RELAXED);
+    uint64_t deadline = last_activity + IDLE_TIMEOUT_MS;
+
+    // A atividade só é registrada no relógio da conexão; o prazo é reagendado aqui
+    if (to_tick(deadline) > wheel->now) {
+        timer_wheel_schedule(wheel, entry, to_tick(deadline));
+        return;
+    }
+
+    // Acorda a thread do cliente, que encontrará o socket encerrado
+    __atomic_store_n(&conn->timed_out, 1, __ATOMIC_RELAXED);
+    shutdown(conn->fd, SHUT_RDWR);
+}
+
+// Avança a roda periodicamente
+static void *idle_monitor(void *arg) {
+    (void)arg;
+    struct timespec interval = {0, IDLE_TICK_MS * 1000000L};
+
+    while (1) {
+        nanosleep(&interval, NULL);
+
+        pthread_mutex_lock(&idle_mutex);
+        timer_wheel_advance(&idle_wheel, to_tick(monotonic_ms()), &idle_wheel);
+        pthread_mutex_unlock(&idle_mutex);
+    }
+    return NULL;
+}
+
+// Inicia a thread de monitoramento das conexões ociosas
+int idle_monitor_start() {
+    pthread_t thread_id;
+
+    timer_wheel_init(&idle_wheel, to_tick(monotonic_ms()));
+    if (pthread_create(&thread_id, NULL, idle_monitor, NULL) != 0) {
+        return -1;
+    }
+    pthread_detach(thread_id);
+    return 0;
+}
+
+// Indica se o endereço é de loopback (127.0.0.0/8, ::1 ou um IPv4 de loopback mapeado em IPv6)
+static int loopback_address(const struct sockaddr_storage *address) {
+    if (address->ss_family == AF_INET) {
+        const unsigned char *bytes = (const unsigned char *)&((const struct sockaddr_in *)address)->sin_addr;
+        return bytes[0] == 127;
+    }
+
+    const struct in6_addr *ip6 = &((const struct sockaddr_in6 *)address)->sin6_addr;
+    return IN6_IS_ADDR_LOOPBACK(ip6) || (IN6_IS_ADDR_V4MAPPED(ip6) && ip6->s6_addr[12] == 127);
+}
+
+// Identifica o cliente. Clientes remotos são identificados pelo endereço de origem, e
+// reconectar não renova as fichas. Os locais compartilham o mesmo endereço ou usuário;
+// por isso cada processo (SO_PEERCRED) ou, no loopback, cada conexão tem o seu balde.
+static void peer_key_init(peer_key *key, int fd) {
+    struct sockaddr_storage address;
+    socklen_t length = sizeof(address);
+
+    memset(key, 0, sizeof(*key));
+    if (getpeername(fd, (struct sockaddr *)&address, &length) != 0) {
+        return;
+    }
+
+    key->family = address.ss_family;
+    if (address.ss_family == AF_INET) {
+        memcpy(key->address, &((struct sockaddr_in *)&address)->sin_addr, sizeof(struct in_addr));
+    } else if (address.ss_family == AF_INET6) {
+        memcpy(key->address, &((struct sockaddr_in6 *)&address)->sin6_addr, sizeof(struct in6_addr));
+    } else if (address.ss_family == AF_UNIX) {
+        struct ucred credentials;
+        socklen_t size = sizeof(credentials);
+        key->local = 1;
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0) {
+            key->instance = (uint32_t)credentials.pid;
+        }
+        return;
+    } else {
+        return;
+    }
+
+    if (loopback_address(&address)) {
+        key->local = 1;
+        key->instance = address.ss_family == AF_INET ? ((struct sockaddr_in *)&address)->sin_port
+                                                     : ((struct sockaddr_in6 *)&address)->sin6_port;
+    }
+}
+
+// Inicializa a conexão e agenda seu prazo de inatividade
+void connection_init(connection *conn, int fd) {
+    uint64_t now = monotonic_ms();
+
+    conn->fd = fd;
+    conn->last_activity_ms = now;
+    conn->timed_out = 0;
+    conn->compressor = NULL;
+    memset(&conn->in, 0, sizeof(conn->in));
+    output_queue_init(&conn->out);
+    peer_key_init(&conn->peer, fd);
+    timer_entry_init(&conn->idle_timer, idle_expired);
+
+    pthread_mutex_lock(&idle_mutex);
+    timer_wheel_schedule(&idle_wheel, &conn->idle_timer, to_tick(now + IDLE_TIMEOUT_MS));
+    pthread_mutex_unlock(&idle_mutex);
+}
+
+// Registra atividade do cliente sem tocar na roda
+void connection_touch(connection *conn) {
+    __atomic_store_n(&conn->last_activity_ms, monotonic_ms(), __ATOMIC_RELAXED);
+}
+
+// Indica se a conexão foi encerrada pelo monitor de inatividade
+int connection_timed_out(connection *conn) {
+    return __atomic_load_n(&conn->timed_out, __ATOMIC_RELAXED);
+}
+
+// Guarda os dados recebidos depois do que sobrou das leituras anteriores
+int connection_input_append(connection *conn, const char *data, size_t length) {
+    input_buffer *in = &conn->in;
+
+    if (in->length + length > in->capacity) {
+        size_t capacity = in->capacity ? in->capacity : 4096;
+        while (capacity < in->length + length) {
+            capacity *= 2;
+        }
+        char *grown = realloc(in->data, capacity);
+        if (!grown) {
+            return -1;
+        }
+        in->data = grown;
+        in->capacity = capacity;
+    }
+
+    memcpy(in->data + in->length, data, length);
+    in->length += length;
+    return 0;
+}
+
+// Separa a próxima linha; o resto de uma linha incompleta vai para o início do buffer
+int connection_next_request(connection *conn, char **request) {
+    input_buffer *in = &conn->in;
+
+    while (1) {
+        char *begin = in->data + in->start;
+        size_t available = in->length - in->start;
+        char *end = available ? memchr(begin, '\n', available) : NULL;
+
+        if (!end) {
+            if (in->start > 0) {
+                memmove(in->data, begin, available);
+                in->length = available;
+                in->start = 0;
+            }
+
+            // Uma linha longa demais não é guardada até o fim: só é preciso achar o '\n'
+            if (in->discarding || in->length > REQUEST_LINE_MAX) {
+                in->length = 0;
+                if (!in->discarding) {
+                    in->discarding = 1;
+                    return -1;
+                }
+            }
+            return 0;
+        }
+
+        *end = '\0';
+        in->start = end + 1 - in->data;
+
+        // Fim de uma linha longa demais já recusada
+        if (in->discarding) {
+            in->discarding = 0;
+            continue;
+        }
+        if ((size_t)(end - begin) > REQUEST_LINE_MAX) {
+            return -1;
+        }
+
+        *request = begin;
+        return 1;
+    }
+}
+
+// Configura o limite antes de os clientes serem aceitos
+void connection_set_rate_limit(int local, double rate_per_second, double burst) {
+    peer_limiter_configure(local ? &local_limiter : &remote_limiter, rate_per_second, burst);
+}
+
+// Consome uma ficha do balde compartilhado pelas conexões do mesmo cliente
+int connection_allow_request(connection *conn, uint64_t now_ms) {
+    return peer_limiter_take(conn->peer.local ? &local_limiter : &remote_limiter, &conn->peer, now_ms);
+}
+
+// Cancela o prazo, libera a fila e fecha o socket
+void connection_close(connection *conn) {
+    pthread_mutex_lock(&idle_mutex);
+    timer_wheel_cancel(&conn->idle_timer);
+    pthread_mutex_unlock(&idle_mutex);
+
+    free(conn->in.data);
+    output_queue_free(&conn->out);
+    response_compressor_free(conn->compressor);
+    close(conn->fd);
+}
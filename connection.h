@@ -0,0 +1,107 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "compression.h"
+#include "output_queue.h"
+#include "rate_limit.h"
+#include "timer_wheel.h"
+
+// Número máximo de clientes atendidos simultaneamente
+#define MAX_CONNECTIONS 256
+
+// Tempo sem atividade após o qual o cliente é desconectado
+#define IDLE_TIMEOUT_MS 60000
+
+// Prazo para os clientes concluírem as requisições em andamento no encerramento
+#define SHUTDOWN_DRAIN_MS 10000
+
+// Resolução da roda de temporização das conexões ociosas
+#define IDLE_TICK_MS 100
+
+// Fila de conexões aguardando accept; comporta todas as vagas de clientes
+#define LISTEN_BACKLOG MAX_CONNECTIONS
+
+// Limite padrão de requisições por cliente remoto (taxa sustentada e rajada
+// máxima), somando todas as conexões de um mesmo endereço
+#define RATE_LIMIT_PER_SECOND 50
+#define RATE_LIMIT_BURST 100
+
+// Limite padrão para clientes locais (socket Unix, memória compartilhada ou
+// loopback), contado por processo ou, no loopback, por conexão
+#define LOCAL_RATE_LIMIT_PER_SECOND 1000
+#define LOCAL_RATE_LIMIT_BURST 2000
+
+// Tamanho máximo de uma requisição, sem contar o '\n' que a termina
+#define REQUEST_LINE_MAX 16384
+
+// Dados recebidos que ainda não formam uma linha completa. As requisições chegam
+// em um fluxo de bytes e podem ser divididas em várias leituras.
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    size_t start;     // início da próxima linha ainda não entregue
+    int discarding;   // descartando o restante de uma linha longa demais
+} input_buffer;
+
+// Estado de uma conexão com um cliente
+typedef struct {
+    int fd;
+    input_buffer in;
+    output_queue out;
+    peer_key peer;
+    timer_entry idle_timer;
+    uint64_t last_activity_ms;
+    int timed_out; // escrito pelo monitor de inatividade; acessado com __atomic
+    response_compressor *compressor;
+} connection;
+
+// Processa os dados lidos de um cliente; retorna 1 se o cliente pediu para sair
+typedef int (*input_handler)(connection *conn, char *data);
+
+// Relógio monotônico em milissegundos
+uint64_t monotonic_ms();
+
+// Reserva uma vaga para um novo cliente; retorna -1 se o limite foi atingido
+int connection_slot_acquire();
+void connection_slot_release();
+
+// Aguarda o encerramento de todos os clientes por até timeout_ms
+int connection_wait_all(int timeout_ms);
+
+// Cria um socket Unix de escuta no caminho informado e guarda em bound a identidade
+// do arquivo criado. Um arquivo deixado por uma execução anterior é removido; se outro
+// servidor ainda atende no caminho, retorna -1 com errno EADDRINUSE.
+int unix_listen(const char *path, struct stat *bound);
+
+// Remove o arquivo do socket apenas se ele ainda for o criado por unix_listen
+void unix_unlink(const char *path, const struct stat *bound);
+
+// Inicia a thread que desconecta clientes ociosos
+int idle_monitor_start();
+
+// Funções do ciclo de vida de uma conexão
+void connection_init(connection *conn, int fd);
+void connection_touch(connection *conn);
+int connection_timed_out(connection *conn);
+
+// Acrescenta dados recebidos à entrada da conexão; retorna -1 se faltar memória
+int connection_input_append(connection *conn, const char *data, size_t length);
+
+// Obtém a próxima requisição completa, com o '\n' trocado por '\0': retorna 1 e
+// aponta *request para ela, 0 se ainda falta o fim da linha ou -1, uma única vez
+// por linha, se ela excedeu REQUEST_LINE_MAX (o conteúdo é descartado)
+int connection_next_request(connection *conn, char **request);
+
+// Altera o limite de clientes remotos ou locais (taxa zero desativa o limite); só
+// pode ser chamada antes de o servidor aceitar clientes
+void connection_set_rate_limit(int local, double rate_per_second, double burst);
+
+// Consome uma ficha do limite do cliente; retorna 0 se a requisição deve ser recusada
+int connection_allow_request(connection *conn, uint64_t now_ms);
+void connection_close(connection *conn);
+
+#endif
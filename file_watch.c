@@ -0,0 +1,113 @@
+#include "file_watch.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+static int inotify_fd = -1;
+static int stop_pipe[2] = {-1, -1};
+static char *watched_name = NULL;
+static void (*change_callback)();
+static pthread_t watch_thread;
+
+// Lê os eventos pendentes; retorna 1 se algum se refere ao arquivo observado
+static int drain_events() {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int relevant = 0;
+
+    while (1) {
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return relevant;
+        }
+
+        for (char *p = buffer; p < buffer + length;) {
+            struct inotify_event *event = (struct inotify_event *)p;
+            if (event->mask & IN_Q_OVERFLOW) {
+                relevant = 1;
+            } else if (event->len > 0 && strcmp(event->name, watched_name) == 0) {
+                relevant = 1;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+// Aguarda eventos e avisa quando o arquivo parar de mudar por FILE_WATCH_SETTLE_MS
+static void *watch_loop(void *arg) {
+    (void)arg;
+    struct pollfd fds[2] = {
+        {.fd = inotify_fd, .events = POLLIN, .revents = 0},
+        {.fd = stop_pipe[0], .events = POLLIN, .revents = 0},
+    };
+    int changed = 0;
+
+    while (1) {
+        int ready = poll(fds, 2, changed ? FILE_WATCH_SETTLE_MS : -1);
+        if (ready < 0 && errno != EINTR) {
+            perror("poll");
+            return NULL;
+        }
+        if (fds[1].revents & POLLIN) {
+            return NULL;
+        }
+
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            changed |= drain_events();
+        } else if (ready == 0 && changed) {
+            changed = 0;
+            change_callback();
+        }
+    }
+}
+
+// Inicia a observação
+int file_watch_start(const char *dir, const char *name, void (*on_change)()) {
+    // O diretório é observado, e não o arquivo: uma substituição por renomeação
+    // troca o inode, e a observação do arquivo antigo deixaria de receber eventos
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        return -1;
+    }
+    if (inotify_add_watch(inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 || pipe(stop_pipe) != 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+        return -1;
+    }
+
+    watched_name = strdup(name);
+    change_callback = on_change;
+    if (!watched_name || pthread_create(&watch_thread, NULL, watch_loop, NULL) != 0) {
+        free(watched_name);
+        watched_name = NULL;
+        close(inotify_fd);
+        close(stop_pipe[0]);
+        close(stop_pipe[1]);
+        inotify_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// Encerra a observação
+void file_watch_stop() {
+    if (inotify_fd < 0) {
+        return;
+    }
+
+    ssize_t ignored = write(stop_pipe[1], "x", 1);
+    (void)ignored;
+    pthread_join(watch_thread, NULL);
+
+    close(inotify_fd);
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+    free(watched_name);
+    inotify_fd = -1;
+    watched_name = NULL;
+}
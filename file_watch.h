@@ -0,0 +1,15 @@
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+// Intervalo sem novos eventos antes de avisar sobre uma alteração, para que uma
+// gravação em várias etapas resulte em um único aviso
+#define FILE_WATCH_SETTLE_MS 50
+
+// Observa com inotify o arquivo name do diretório dir e chama on_change, em uma
+// thread própria, quando ele é regravado ou substituído por renomeação
+int file_watch_start(const char *dir, const char *name, void (*on_change)());
+
+// Encerra a observação e aguarda a thread
+void file_watch_stop();
+
+#endif
@@ -1,32 +1,547 @@
 #include "json_operations.h"
+#include "text_match.h"
+#include "aggregates.h"
+#include "catalog.h"
+#include "file_watch.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #define DB_FILE "movies.json"
+#define DB_TMP_FILE "movies.json.tmp"
+#define DB_DIR "."
 
-// Mutex para sincronização de acesso ao banco de dados
+// Mutex para sincronização das escritas no banco de dados; as leituras usam as
+// versões residentes publicadas em catalog.h e nunca o aguardam
 pthread_mutex_t db_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-// Carrega o banco de dados de um arquivo JSON
-json_t* load_database() {
+// Contadores por gênero, diretor e década. Eles refletem a versão aggregates_version
+// do catálogo: uma escrita só os altera depois de publicar a nova versão, com as
+// diferenças que registrou, e após uma recarga (ou qualquer falha) eles são
+// recontados na próxima consulta. aggregates_mutex só é mantido durante operações
+// em memória, nunca durante a gravação do arquivo.
+static pthread_mutex_t aggregates_mutex = PTHREAD_MUTEX_INITIALIZER;
+static aggregate_table aggregates[AGGREGATE_DIMENSIONS];
+static int aggregates_valid = 0;
+static uint64_t aggregates_version = 0;
+
+// Salva o banco de dados de forma atômica: grava um arquivo temporário,
+// força sua escrita em disco e só então o renomeia sobre o arquivo original.
+// Em saved fica a identidade do arquivo gravado.
+static int save_database(json_t *root, struct stat *saved) {
+    TRACE_BEGIN(span);
+    int fd = open(DB_TMP_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Erro ao salvar o banco de dados: %s\n", strerror(errno));
+        return -1;
+    }
+
+    FILE *file = fdopen(fd, "w");
+    if (!file) {
+        close(fd);
+        unlink(DB_TMP_FILE);
+        fprintf(stderr, "Erro ao salvar o banco de dados: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int failed = json_dumpf(root, file, JSON_INDENT(2)) != 0;
+    failed |= fflush(file) != 0;
+    failed |= fsync(fd) != 0;
+    failed |= fclose(file) != 0;
+
+    // Em caso de falha o arquivo original permanece intacto
+    if (failed || rename(DB_TMP_FILE, DB_FILE) != 0) {
+        unlink(DB_TMP_FILE);
+        fprintf(stderr, "Erro ao salvar o banco de dados\n");
+        return -1;
+    }
+
+    // Garante que a renomeação também seja persistida
+    int dir_fd = open(DB_DIR, O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+
+    if (stat(DB_FILE, saved) != 0) {
+        memset(saved, 0, sizeof(*saved));
+    }
+    TRACE_END(span, "save_database");
+    return 0;
+}
+
+// Lê e interpreta o arquivo; retorna NULL, com o motivo em error->text, se ele não
+// for JSON válido ou não tiver a lista de filmes
+static json_t *parse_database(json_error_t *error) {
+    TRACE_BEGIN(span);
+    json_t *root = json_load_file(DB_FILE, 0, error);
+    TRACE_END(span, "load_database");
+    if (root && !json_is_array(json_object_get(root, "movies"))) {
+        snprintf(error->text, sizeof(error->text), "formato inválido");
+        json_decref(root);
+        return NULL;
+    }
+    return root;
+}
+
+// Carrega o banco de dados de um arquivo JSON. A identidade do arquivo é obtida
+// antes da leitura: se ele for trocado no meio, a recarga percebe a diferença.
+// Um arquivo que não pode ser interpretado nunca é substituído: retorna NULL.
+static json_t* load_database(struct stat *file) {
+    int missing = stat(DB_FILE, file) != 0;
+    if (missing && errno != ENOENT) {
+        fprintf(stderr, "Erro ao abrir o banco de dados %s: %s\n", DB_FILE, strerror(errno));
+        return NULL;
+    }
+
+    // Só um arquivo inexistente ou vazio dá lugar a um banco de dados novo
+    if (missing || file->st_size == 0) {
+        json_t *root = json_pack("{s:[], s:i}", "movies", "last_id", 0);
+        if (root && save_database(root, file) != 0) {
+            memset(file, 0, sizeof(*file));
+        }
+        return root;
+    }
+
     json_error_t error;
-    json_t *root = json_load_file(DB_FILE, 0, &error);
+    json_t *root = parse_database(&error);
     if (!root) {
-        // Se o arquivo não existe ou está vazio, cria um novo banco de dados
-        root = json_pack("{s:[], s:i}", "movies", "last_id", 0);
-        json_dump_file(root, DB_FILE, JSON_INDENT(2));
+        fprintf(stderr, "Erro ao carregar o banco de dados %s: %s (o arquivo não foi alterado)\n", DB_FILE,
+                error.text);
     }
     return root;
 }
 
-// Salva o banco de dados em um arquivo JSON
-void save_database(json_t *root) {
-    if (json_dump_file(root, DB_FILE, JSON_INDENT(2)) != 0) {
-        fprintf(stderr, "Erro ao salvar o banco de dados\n");
+// Bloqueia os contadores, registrando a espera no rastreamento
+static void aggregates_lock() {
+    TRACE_BEGIN(span);
+    pthread_mutex_lock(&aggregates_mutex);
+    TRACE_END(span, "aggregates_mutex_wait");
+}
+
+// Indica se dois arquivos são a mesma versão do banco de dados
+static int same_file(const struct stat *a, const struct stat *b) {
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+// Descarta os contadores
+static void aggregates_invalidate() {
+    for (int i = 0; i < AGGREGATE_DIMENSIONS; i++) {
+        aggregate_table_free(&aggregates[i]);
     }
+    aggregates_valid = 0;
+}
+
+// Indica se os contadores refletem a versão informada ou uma mais recente
+static int aggregates_current(const catalog_version *version) {
+    return aggregates_valid && aggregates_version >= version->number;
+}
+
+// Primeiro ano da década
+static int decade_of(int year) {
+    return year >= 0 ? year / 10 * 10 : -((-year + 9) / 10 * 10);
+}
+
+// Compara dois gêneros com a mesma dobra de caixa usada pelos contadores
+static int same_genre(const char *a, const char *b) {
+    size_t length = strlen(a);
+    char folded_a[256];
+    char folded_b[256];
+
+    if (length != strlen(b)) {
+        return 0;
+    }
+    if (length > sizeof(folded_a)) {
+        return strcmp(a, b) == 0;
+    }
+
+    text_fold(a, length, folded_a);
+    text_fold(b, length, folded_b);
+    return memcmp(folded_a, folded_b, length) == 0;
+}
+
+// Indica se o gênero na posição index já aparece antes na lista do filme
+static int genre_listed_before(json_t *genres, size_t index) {
+    const char *genre = json_string_value(json_array_get(genres, index));
+    if (!genre) {
+        return 1;
+    }
+    for (size_t i = 0; i < index; i++) {
+        const char *previous = json_string_value(json_array_get(genres, i));
+        if (previous && same_genre(previous, genre)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Soma delta a um contador, descartando todos se faltar memória
+static void aggregates_add(aggregate_dimension dimension, const char *key, int delta) {
+    if (!aggregates_valid || !key) {
+        return;
+    }
+    if (aggregate_table_add(&aggregates[dimension], key, delta) != 0) {
+        aggregates_invalidate();
+    }
+}
+
+// Destino das chaves de um filme: os contadores ou as diferenças de uma escrita
+typedef void (*aggregate_sink)(void *context, aggregate_dimension dimension, const char *key, int delta);
+
+// Envia ao destino as chaves de um filme a contar (delta 1) ou descartar (delta -1)
+static void aggregates_visit_movie(json_t *movie, int delta, aggregate_sink sink, void *context) {
+    json_t *genres = json_object_get(movie, "genres");
+    size_t index;
+    json_t *genre;
+    json_array_foreach(genres, index, genre) {
+        if (!genre_listed_before(genres, index)) {
+            sink(context, AGGREGATE_GENRE, json_string_value(genre), delta);
+        }
+    }
+
+    sink(context, AGGREGATE_DIRECTOR, json_string_value(json_object_get(movie, "director")), delta);
+
+    char decade[32];
+    int start = decade_of((int)json_integer_value(json_object_get(movie, "year")));
+    snprintf(decade, sizeof(decade), "%d-%d", start, start + 9);
+    sink(context, AGGREGATE_DECADE, decade, delta);
+}
+
+static void aggregates_sink(void *context, aggregate_dimension dimension, const char *key, int delta) {
+    (void)context;
+    aggregates_add(dimension, key, delta);
+}
+
+// Recalcula os contadores a partir de uma versão do catálogo
+static int aggregates_rebuild(const catalog_version *version) {
+    TRACE_BEGIN(span);
+    aggregates_invalidate();
+    aggregates_valid = 1;
+
+    size_t index;
+    json_t *movie;
+    json_array_foreach(json_object_get(version->root, "movies"), index, movie) {
+        if (!aggregates_valid) {
+            break;
+        }
+        aggregates_visit_movie(movie, 1, aggregates_sink, NULL);
+    }
+
+    aggregates_version = version->number;
+    TRACE_END(span, "aggregates_rebuild");
+    return aggregates_valid;
+}
+
+// Publica a primeira versão a partir do arquivo; chamada com db_mutex bloqueado
+static catalog_version *load_catalog() {
+    catalog_version *version = catalog_acquire();
+    if (!version) {
+        struct stat file;
+        json_t *root = load_database(&file);
+        if (!root) {
+            return NULL;
+        }
+        if (!catalog_publish(root, &file)) {
+            return NULL;
+        }
+        version = catalog_acquire();
+    }
+    return version;
+}
+
+// Obtém a versão atual do catálogo; só a primeira chamada lê o arquivo
+static catalog_version *acquire_catalog() {
+    catalog_version *version = catalog_acquire();
+    if (!version) {
+        db_lock();
+        version = load_catalog();
+        db_unlock();
+    }
+    return version;
+}
+
+// Obtém a versão sobre a qual uma escrita vai trabalhar; chamada com db_mutex
+// bloqueado. Se o arquivo foi substituído por fora e a recarga ainda não aconteceu,
+// ele é recarregado agora, para que a escrita não desfaça a alteração; um arquivo
+// que não pode ser interpretado faz a escrita ser recusada e continua intacto.
+static catalog_version *load_catalog_for_write() {
+    catalog_version *version = load_catalog();
+    if (!version) {
+        return NULL;
+    }
+
+    // Um arquivo removido é recriado pela escrita a partir do catálogo em memória
+    struct stat file;
+    if (stat(DB_FILE, &file) != 0) {
+        if (errno == ENOENT) {
+            return version;
+        }
+        fprintf(stderr, "Escrita recusada: erro ao verificar %s: %s\n", DB_FILE, strerror(errno));
+        catalog_release(version);
+        return NULL;
+    }
+    if (same_file(&file, &version->file)) {
+        return version;
+    }
+    catalog_release(version);
+
+    json_error_t error;
+    json_t *root = parse_database(&error);
+    if (!root) {
+        fprintf(stderr, "Escrita recusada: %s foi alterado por outro processo e não pode ser interpretado: %s\n",
+                DB_FILE, error.text);
+        return NULL;
+    }
+    if (!catalog_publish(root, &file)) {
+        fprintf(stderr, "Escrita recusada: não foi possível recarregar %s\n", DB_FILE);
+        return NULL;
+    }
+    printf("Banco de dados recarregado de %s antes de uma escrita\n", DB_FILE);
+    return catalog_acquire();
+}
+
+// Diferença em um contador produzida por uma escrita
+typedef struct {
+    aggregate_dimension dimension;
+    char *key;
+    int delta;
+} aggregate_delta;
+
+// Escrita em andamento sobre uma cópia da versão atual. As diferenças nos
+// contadores ficam registradas e só são aplicadas se a nova versão for publicada.
+typedef struct {
+    catalog_version *base;
+    json_t *root;
+    aggregate_delta *deltas;
+    size_t delta_count;
+    size_t delta_capacity;
+    int deltas_lost;
+} catalog_write;
+
+// Registra uma diferença; se faltar memória, os contadores serão recontados
+static void write_sink(void *context, aggregate_dimension dimension, const char *key, int delta) {
+    catalog_write *write = context;
+    if (!key || write->deltas_lost) {
+        return;
+    }
+
+    if (write->delta_count == write->delta_capacity) {
+        size_t capacity = write->delta_capacity ? write->delta_capacity * 2 : 16;
+        aggregate_delta *deltas = realloc(write->deltas, capacity * sizeof(aggregate_delta));
+        if (!deltas) {
+            write->deltas_lost = 1;
+            return;
+        }
+        write->deltas = deltas;
+        write->delta_capacity = capacity;
+    }
+
+    char *copy = strdup(key);
+    if (!copy) {
+        write->deltas_lost = 1;
+        return;
+    }
+    write->deltas[write->delta_count++] = (aggregate_delta){dimension, copy, delta};
+}
+
+// Prepara uma escrita; chamada com db_mutex bloqueado. A cópia é rasa: os filmes
+// continuam compartilhados com a versão atual e só são copiados quando alterados.
+static int begin_write(catalog_write *write) {
+    write->deltas = NULL;
+    write->delta_count = 0;
+    write->delta_capacity = 0;
+    write->deltas_lost = 0;
+
+    write->base = load_catalog_for_write();
+    if (!write->base) {
+        return -1;
+    }
+
+    write->root = json_copy(write->base->root);
+    json_t *movies = json_copy(json_object_get(write->base->root, "movies"));
+    if (!write->root || !movies) {
+        json_decref(write->root);
+        json_decref(movies);
+        catalog_release(write->base);
+        return -1;
+    }
+    json_object_set_new(write->root, "movies", movies);
+    return 0;
+}
+
+// Conclui uma escrita: se houve alteração, grava o arquivo e publica a nova versão;
+// caso contrário, ou se a gravação falhar, a cópia é descartada. Se não houver
+// posição para a nova versão, a escrita é recusada antes de o arquivo ser gravado.
+// Retorna 1 se a alteração foi gravada e publicada.
+static int commit_write(catalog_write *write, int changed) {
+    uint64_t published = 0;
+    struct stat file;
+    if (changed && !catalog_can_publish()) {
+        fprintf(stderr, "Escrita recusada: todas as %d versões do catálogo estão em uso por leitores\n",
+                CATALOG_MAX_VERSIONS);
+        json_decref(write->root);
+    } else if (changed && save_database(write->root, &file) == 0) {
+        published = catalog_publish(write->root, &file);
+    } else {
+        json_decref(write->root);
+    }
+
+    // Os contadores recebem as diferenças só depois da publicação, e apenas se
+    // refletiam a versão de partida; se uma consulta já os recontou a partir da
+    // nova versão, nada precisa ser feito
+    aggregates_lock();
+    if (aggregates_valid) {
+        if (published && !write->deltas_lost && aggregates_version == write->base->number) {
+            for (size_t i = 0; i < write->delta_count; i++) {
+                aggregates_add(write->deltas[i].dimension, write->deltas[i].key, write->deltas[i].delta);
+            }
+            aggregates_version = published;
+        } else if (changed && (!published || aggregates_version < published)) {
+            aggregates_invalidate();
+        }
+    }
+    pthread_mutex_unlock(&aggregates_mutex);
+
+    for (size_t i = 0; i < write->delta_count; i++) {
+        free(write->deltas[i].key);
+    }
+    free(write->deltas);
+    catalog_release(write->base);
+    return published != 0;
+}
+
+// Recarrega o catálogo quando o arquivo foi substituído por fora do servidor. A
+// leitura e a interpretação acontecem sem bloqueios; só a troca de versão aguarda
+// as escritas em andamento, e os leitores continuam na versão que já obtiveram.
+static void db_reload() {
+    struct stat file;
+
+    // As gravações do próprio servidor já foram publicadas com a identidade do arquivo
+    db_lock();
+    catalog_version *current = catalog_acquire();
+    int changed = current && stat(DB_FILE, &file) == 0 && !same_file(&file, &current->file);
+    if (current) {
+        catalog_release(current);
+    }
+    db_unlock();
+
+    if (!changed) {
+        return;
+    }
+
+    json_error_t error;
+    json_t *root = parse_database(&error);
+    if (!root) {
+        fprintf(stderr, "Erro ao recarregar o banco de dados: %s\n", error.text);
+        return;
+    }
+
+    // Se o arquivo mudou de novo durante a leitura, esta versão é descartada: a nova
+    // alteração gera outro aviso, ou veio de uma escrita que já foi publicada
+    db_lock();
+    struct stat now;
+    if (stat(DB_FILE, &now) == 0 && same_file(&now, &file)) {
+        if (catalog_publish(root, &file)) {
+            printf("Banco de dados recarregado de %s\n", DB_FILE);
+        }
+    } else {
+        json_decref(root);
+    }
+    db_unlock();
+}
+
+// Carrega o catálogo; retorna -1 se o arquivo existente não puder ser interpretado
+int db_open() {
+    catalog_version *version = acquire_catalog();
+    if (!version) {
+        return -1;
+    }
+    catalog_release(version);
+    return 0;
+}
+
+// Passa a recarregar o catálogo quando o arquivo for substituído
+int db_watch_start() {
+    return file_watch_start(DB_DIR, DB_FILE, db_reload);
+}
+
+// Buffer de texto que cresce conforme a resposta aumenta
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;
+} text_buffer;
+
+// Inicializa o buffer com uma capacidade inicial
+static int text_buffer_init(text_buffer *buffer, size_t capacity) {
+    buffer->data = malloc(capacity);
+    buffer->length = 0;
+    buffer->capacity = capacity;
+    buffer->failed = buffer->data == NULL;
+    if (buffer->data) {
+        buffer->data[0] = '\0';
+    }
+    return buffer->failed ? -1 : 0;
+}
+
+// Acrescenta texto formatado ao buffer, realocando quando necessário
+static void text_buffer_printf(text_buffer *buffer, const char *format, ...) {
+    if (buffer->failed) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+    va_end(args);
+
+    if (needed < 0) {
+        buffer->failed = 1;
+        return;
+    }
+
+    if (buffer->length + needed >= buffer->capacity) {
+        size_t capacity = buffer->capacity * 2;
+        while (capacity <= buffer->length + needed) {
+            capacity *= 2;
+        }
+
+        char *data = realloc(buffer->data, capacity);
+        if (!data) {
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+
+        va_start(args, format);
+        vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+        va_end(args);
+    }
+
+    buffer->length += needed;
+}
+
+// Entrega o texto final ao chamador (NULL se alguma alocação falhou)
+static char* text_buffer_finish(text_buffer *buffer) {
+    if (buffer->failed) {
+        free(buffer->data);
+        return NULL;
+    }
+    return buffer->data;
 }
 
 // Bloqueia o acesso ao banco de dados
 void db_lock() {
+    TRACE_BEGIN(span);
     pthread_mutex_lock(&db_mutex);
+    TRACE_END(span, "db_mutex_wait");
 }
 
 // Desbloqueia o acesso ao banco de dados
@@ -34,25 +549,33 @@ void db_unlock() {
     pthread_mutex_unlock(&db_mutex);
 }
 
+// Encerra a recarga automática, aguarda a gravação em andamento e impede novas
+// escritas antes do encerramento
+void db_close() {
+    file_watch_stop();
+    pthread_mutex_lock(&db_mutex);
+}
+
 // Obtém o próximo ID disponível
 int get_next_id() {
     int next_id = 0;
-    json_t *root = load_database();
-    json_t *last_id = json_object_get(root, "last_id");
+    catalog_version *version = acquire_catalog();
+    if (!version) {
+        return 0;
+    }
+    json_t *last_id = json_object_get(version->root, "last_id");
     
     if (last_id) {
         next_id = json_integer_value(last_id) + 1;
     }
     
-    json_decref(root);
+    catalog_release(version);
     return next_id;
 }
 
-// Adiciona um novo filme ao banco de dados
-int add_movie(const char *title, const char *genres, const char *director, int year) {
-    db_lock();
-    
-    json_t *root = load_database();
+// Insere um novo filme na cópia em escrita e retorna seu ID
+static int insert_movie(catalog_write *write, const char *title, const char *genres, const char *director, int year) {
+    json_t *root = write->root;
     json_t *movies = json_object_get(root, "movies");
     json_t *last_id_json = json_object_get(root, "last_id");
     
@@ -71,7 +594,8 @@ int add_movie(const char *title, const char *genres, const char *director, int y
     // Processa os gêneros
     json_t *genres_array = json_array();
     char *genres_copy = strdup(genres);
-    char *token = strtok(genres_copy, ",");
+    char *saveptr;
+    char *token = strtok_r(genres_copy, ",", &saveptr);
     while (token) {
         // Remove espaços extras
         while (*token == ' ') token++;
@@ -79,7 +603,7 @@ int add_movie(const char *title, const char *genres, const char *director, int y
         while (end > token && *end == ' ') *end-- = '\0';
         
         json_array_append_new(genres_array, json_string(token));
-        token = strtok(NULL, ",");
+        token = strtok_r(NULL, ",", &saveptr);
     }
     free(genres_copy);
     
@@ -89,25 +613,17 @@ int add_movie(const char *title, const char *genres, const char *director, int y
     
     // Adiciona o filme ao array de filmes
     json_array_append_new(movies, new_movie);
+    aggregates_visit_movie(new_movie, 1, write_sink, write);
     
     // Atualiza o último ID
     json_object_set_new(root, "last_id", json_integer(new_id));
     
-    // Salva o banco de dados
-    save_database(root);
-    json_decref(root);
-    
-    db_unlock();
     return new_id;
 }
 
-// Adiciona um novo gênero a um filme existente
-int add_genre_to_movie(int id, const char *genre) {
-    db_lock();
-    int success = 0;
-    
-    json_t *root = load_database();
-    json_t *movies = json_object_get(root, "movies");
+// Acrescenta um gênero a um filme da cópia em escrita
+static int insert_genre(catalog_write *write, int id, const char *genre) {
+    json_t *movies = json_object_get(write->root, "movies");
     
     // Procura o filme pelo ID
     size_t index;
@@ -119,84 +635,183 @@ int add_genre_to_movie(int id, const char *genre) {
             json_t *genres = json_object_get(movie, "genres");
             
             // Verifica se o gênero já existe
-            int genre_exists = 0;
             size_t i;
             json_t *existing_genre;
+            int counted = 0;
             json_array_foreach(genres, i, existing_genre) {
                 if (strcmp(json_string_value(existing_genre), genre) == 0) {
-                    genre_exists = 1;
-                    break;
+                    return 0;
                 }
+                counted |= same_genre(json_string_value(existing_genre), genre);
             }
             
-            if (!genre_exists) {
-                json_array_append_new(genres, json_string(genre));
-                success = 1;
+            // O filme é compartilhado com as versões anteriores: a alteração é feita em uma cópia
+            json_t *copy = json_deep_copy(movie);
+            if (!copy) {
+                return 0;
             }
-            break;
+            json_array_append_new(json_object_get(copy, "genres"), json_string(genre));
+            json_array_set_new(movies, index, copy);
+            
+            // Grafias que diferem só na caixa contam uma única vez por filme
+            if (!counted) {
+                write_sink(write, AGGREGATE_GENRE, genre, 1);
+            }
+            return 1;
         }
     }
     
-    // Salva o banco de dados se houve alteração
-    if (success) {
-        save_database(root);
+    return 0;
+}
+
+// Retira um filme da cópia em escrita
+static int delete_movie(catalog_write *write, int id) {
+    json_t *movies = json_object_get(write->root, "movies");
+    
+    size_t index;
+    json_t *movie;
+    json_array_foreach(movies, index, movie) {
+        json_t *movie_id = json_object_get(movie, "id");
+        if (json_integer_value(movie_id) == id) {
+            aggregates_visit_movie(movie, -1, write_sink, write);
+            json_array_remove(movies, index);
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+// Adiciona um novo filme ao banco de dados
+int add_movie(const char *title, const char *genres, const char *director, int year) {
+    catalog_write write;
+    db_lock();
+    
+    if (begin_write(&write) != 0) {
+        db_unlock();
+        return 0;
+    }
+    int new_id = insert_movie(&write, title, genres, director, year);
+    
+    // Salva o banco de dados e publica a nova versão
+    if (!commit_write(&write, 1)) {
+        new_id = 0;
     }
     
-    json_decref(root);
+    db_unlock();
+    return new_id;
+}
+
+// Adiciona um novo gênero a um filme existente
+int add_genre_to_movie(int id, const char *genre) {
+    catalog_write write;
+    db_lock();
+    
+    if (begin_write(&write) != 0) {
+        db_unlock();
+        return 0;
+    }
+    int success = insert_genre(&write, id, genre);
+    
+    // Salva o banco de dados se houve alteração
+    success = commit_write(&write, success);
+    
     db_unlock();
     return success;
 }
 
 // Remove um filme pelo ID
 int remove_movie(int id) {
+    catalog_write write;
     db_lock();
-    int success = 0;
     
-    json_t *root = load_database();
-    json_t *movies = json_object_get(root, "movies");
-    json_t *new_movies = json_array();
+    if (begin_write(&write) != 0) {
+        db_unlock();
+        return 0;
+    }
+    int success = delete_movie(&write, id);
     
-    // Copia todos os filmes, exceto o que será removido
-    size_t index;
-    json_t *movie;
-    json_array_foreach(movies, index, movie) {
-        json_t *movie_id = json_object_get(movie, "id");
-        if (json_integer_value(movie_id) != id) {
-            json_array_append(new_movies, movie);
-        } else {
-            success = 1;
-        }
+    // Salva o banco de dados
+    success = commit_write(&write, success);
+    
+    db_unlock();
+    return success;
+}
+
+// Aplica um lote de operações de escrita de forma atômica: todas são aplicadas
+// sob o mesmo bloqueio e gravadas de uma só vez, ou nenhuma é aplicada
+int apply_transaction(db_operation *ops, size_t count, size_t *failed_index) {
+    catalog_write write;
+    db_lock();
+    
+    if (begin_write(&write) != 0) {
+        *failed_index = 0;
+        db_unlock();
+        return 0;
     }
+    int success = 1;
     
-    // Substitui o array de filmes
-    json_object_set_new(root, "movies", new_movies);
+    for (size_t i = 0; i < count && success; i++) {
+        db_operation *op = &ops[i];
+        
+        // Resolve referências ao ID produzido por uma operação anterior do lote
+        int id = op->id;
+        if (op->id_ref > 0) {
+            if ((size_t)op->id_ref > i || ops[op->id_ref - 1].type != DB_OP_ADD_MOVIE) {
+                success = 0;
+                *failed_index = i;
+                break;
+            }
+            id = ops[op->id_ref - 1].result;
+        }
+        
+        switch (op->type) {
+        case DB_OP_ADD_MOVIE:
+            op->result = insert_movie(&write, op->title, op->genres, op->director, op->year);
+            break;
+        case DB_OP_ADD_GENRE:
+            op->result = insert_genre(&write, id, op->genre) ? id : 0;
+            break;
+        case DB_OP_REMOVE_MOVIE:
+            op->result = delete_movie(&write, id) ? id : 0;
+            break;
+        }
+        
+        if (op->result == 0) {
+            success = 0;
+            *failed_index = i;
+        }
+    }
     
-    // Salva o banco de dados
-    if (success) {
-        save_database(root);
+    // A cópia e as diferenças nos contadores são descartadas se alguma operação falhou
+    // Se a gravação for recusada, a falha é atribuída à última operação
+    int changed = success && count > 0;
+    if (!commit_write(&write, changed) && changed) {
+        success = 0;
+        *failed_index = count - 1;
     }
     
-    json_decref(root);
     db_unlock();
     return success;
 }
 
 // Lista todos os títulos de filmes com seus identificadores
 char* list_all_titles() {
-    db_lock();
-    
-    json_t *root = load_database();
-    json_t *movies = json_object_get(root, "movies");
+    catalog_version *version = acquire_catalog();
+    if (!version) {
+        return NULL;
+    }
+    TRACE_BEGIN(span);
+    json_t *movies = json_object_get(version->root, "movies");
     
     // Aloca espaço para a resposta
-    char *response = malloc(10240);
-    if (!response) {
-        json_decref(root);
-        db_unlock();
+    text_buffer response;
+    if (text_buffer_init(&response, 10240) != 0) {
+        catalog_release(version);
         return NULL;
     }
     
-    sprintf(response, "ID | Título\n-------------------\n");
+    text_buffer_printf(&response, "ID | Título\n-------------------\n");
     
     // Itera sobre os filmes e adiciona os títulos à resposta
     size_t index;
@@ -205,32 +820,41 @@ char* list_all_titles() {
         json_t *id = json_object_get(movie, "id");
         json_t *title = json_object_get(movie, "title");
         
-        char line[512];
-        sprintf(line, "%d | %s\n", (int)json_integer_value(id), json_string_value(title));
-        strcat(response, line);
+        text_buffer_printf(&response, "%d | %s\n", (int)json_integer_value(id), json_string_value(title));
     }
     
-    json_decref(root);
-    db_unlock();
-    return response;
+    TRACE_END(span, "format_response");
+    catalog_release(version);
+    return text_buffer_finish(&response);
+}
+
+// Acrescenta a lista de gêneros de um filme à resposta
+static void append_genres(text_buffer *response, json_t *genres) {
+    size_t i;
+    json_t *genre;
+    json_array_foreach(genres, i, genre) {
+        if (i > 0) text_buffer_printf(response, ", ");
+        text_buffer_printf(response, "%s", json_string_value(genre));
+    }
 }
 
 // Lista informações de todos os filmes
 char* list_all_movies() {
-    db_lock();
-    
-    json_t *root = load_database();
-    json_t *movies = json_object_get(root, "movies");
+    catalog_version *version = acquire_catalog();
+    if (!version) {
+        return NULL;
+    }
+    TRACE_BEGIN(span);
+    json_t *movies = json_object_get(version->root, "movies");
     
     // Aloca espaço para a resposta
-    char *response = malloc(51200);
-    if (!response) {
-        json_decref(root);
-        db_unlock();
+    text_buffer response;
+    if (text_buffer_init(&response, 51200) != 0) {
+        catalog_release(version);
         return NULL;
     }
     
-    strcpy(response, "Lista de Filmes:\n================\n");
+    text_buffer_printf(&response, "Lista de Filmes:\n================\n");
     
     // Itera sobre os filmes e adiciona as informações à resposta
     size_t index;
@@ -242,45 +866,37 @@ char* list_all_movies() {
         json_t *director = json_object_get(movie, "director");
         json_t *year = json_object_get(movie, "year");
         
-        char movie_info[2048];
-        sprintf(movie_info, "\nID: %d\nTítulo: %s\nDiretor: %s\nAno: %d\nGêneros: ", 
+        text_buffer_printf(&response, "\nID: %d\nTítulo: %s\nDiretor: %s\nAno: %d\nGêneros: ", 
                 (int)json_integer_value(id), 
                 json_string_value(title),
                 json_string_value(director),
                 (int)json_integer_value(year));
         
         // Processa os gêneros
-        size_t i;
-        json_t *genre;
-        json_array_foreach(genres, i, genre) {
-            if (i > 0) strcat(movie_info, ", ");
-            strcat(movie_info, json_string_value(genre));
-        }
+        append_genres(&response, genres);
         
-        strcat(movie_info, "\n");
-        strcat(response, movie_info);
+        text_buffer_printf(&response, "\n");
     }
     
-    json_decref(root);
-    db_unlock();
-    return response;
+    TRACE_END(span, "format_response");
+    catalog_release(version);
+    return text_buffer_finish(&response);
 }
 
 // Busca um filme pelo ID
 char* get_movie_by_id(int id) {
-    db_lock();
-    
-    json_t *root = load_database();
-    json_t *movies = json_object_get(root, "movies");
-    
-    char *response = malloc(2048);
-    if (!response) {
-        json_decref(root);
-        db_unlock();
+    catalog_version *version = acquire_catalog();
+    if (!version) {
         return NULL;
     }
+    TRACE_BEGIN(span);
+    json_t *movies = json_object_get(version->root, "movies");
     
-    strcpy(response, "");
+    text_buffer response;
+    if (text_buffer_init(&response, 2048) != 0) {
+        catalog_release(version);
+        return NULL;
+    }
     
     // Procura o filme pelo ID
     size_t index;
@@ -293,92 +909,213 @@ char* get_movie_by_id(int id) {
             json_t *director = json_object_get(movie, "director");
             json_t *year = json_object_get(movie, "year");
             
-            sprintf(response, "ID: %d\nTítulo: %s\nDiretor: %s\nAno: %d\nGêneros: ", 
+            text_buffer_printf(&response, "ID: %d\nTítulo: %s\nDiretor: %s\nAno: %d\nGêneros: ", 
                     id, 
                     json_string_value(title),
                     json_string_value(director),
                     (int)json_integer_value(year));
             
             // Processa os gêneros
-            size_t i;
-            json_t *genre;
-            json_array_foreach(genres, i, genre) {
-                if (i > 0) strcat(response, ", ");
-                strcat(response, json_string_value(genre));
-            }
+            append_genres(&response, genres);
             
             break;
         }
     }
     
-    if (strlen(response) == 0) {
-        strcpy(response, "Filme não encontrado");
+    if (response.length == 0) {
+        text_buffer_printf(&response, "Filme não encontrado");
     }
     
-    json_decref(root);
-    db_unlock();
-    return response;
+    TRACE_END(span, "format_response");
+    catalog_release(version);
+    return text_buffer_finish(&response);
 }
 
-// Lista todos os filmes de um determinado gênero
-char* list_movies_by_genre(const char *genre) {
-    db_lock();
+// Acrescenta o resumo de um filme (sem gêneros) à resposta
+static void append_movie_summary(text_buffer *response, json_t *movie) {
+    json_t *id = json_object_get(movie, "id");
+    json_t *title = json_object_get(movie, "title");
+    json_t *director = json_object_get(movie, "director");
+    json_t *year = json_object_get(movie, "year");
     
-    json_t *root = load_database();
-    json_t *movies = json_object_get(root, "movies");
+    text_buffer_printf(response, "\nID: %d\nTítulo: %s\nDiretor: %s\nAno: %d\n", 
+            (int)json_integer_value(id), 
+            json_string_value(title),
+            json_string_value(director),
+            (int)json_integer_value(year));
+}
+
+// Monta uma coluna de busca com os valores de todos os filmes de uma versão,
+// cada valor associado à posição do seu filme no array
+static int build_column(json_t *root, catalog_column_kind kind, text_column *column) {
+    size_t index;
+    json_t *movie;
+    json_array_foreach(json_object_get(root, "movies"), index, movie) {
+        if (kind == CATALOG_COLUMN_GENRE) {
+            size_t i;
+            json_t *genre;
+            json_array_foreach(json_object_get(movie, "genres"), i, genre) {
+                if (text_column_add(column, json_string_value(genre), index) != 0) {
+                    return -1;
+                }
+            }
+        } else {
+            const char *field = kind == CATALOG_COLUMN_TITLE ? "title" : "director";
+            if (text_column_add(column, json_string_value(json_object_get(movie, field)), index) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Filtra os filmes com os kernels de text_match.h e lista os encontrados. A coluna
+// de gêneros (ou de títulos) é montada uma vez por versão do catálogo.
+static char* list_matching_movies(const char *text, int by_genre, const char *header, const char *empty_message) {
+    catalog_version *version = acquire_catalog();
+    if (!version) {
+        return NULL;
+    }
+    TRACE_BEGIN(span);
+    json_t *movies = json_object_get(version->root, "movies");
+    size_t count = json_array_size(movies);
     
-    char *response = malloc(10240);
-    if (!response) {
-        json_decref(root);
-        db_unlock();
+    text_buffer response;
+    text_pattern pattern;
+    unsigned char *matches = calloc(count + 1, 1);
+    const text_column *column =
+        catalog_column(version, by_genre ? CATALOG_COLUMN_GENRE : CATALOG_COLUMN_TITLE, build_column);
+    
+    int failed = text_buffer_init(&response, 10240) != 0;
+    failed |= !matches;
+    failed |= !column;
+    failed |= text_pattern_init(&pattern, text) != 0;
+    
+    if (failed) {
+        text_pattern_free(&pattern);
+        free(matches);
+        free(response.data);
+        catalog_release(version);
         return NULL;
     }
     
-    sprintf(response, "Filmes do gênero '%s':\n===================\n", genre);
+    text_buffer_printf(&response, header, text);
     
-    // Itera sobre os filmes e procura pelo gênero
+    size_t found = by_genre ? text_column_match_equals(column, &pattern, matches)
+                            : text_column_match_contains(column, &pattern, matches);
+    
+    // Lista os filmes encontrados na ordem do catálogo
     size_t index;
     json_t *movie;
-    int found = 0;
-    
     json_array_foreach(movies, index, movie) {
-        json_t *genres = json_object_get(movie, "genres");
-        
-        // Verifica se o gênero está presente
-        size_t i;
-        json_t *g;
-        int genre_found = 0;
-        
-        json_array_foreach(genres, i, g) {
-            if (strcasecmp(json_string_value(g), genre) == 0) {
-                genre_found = 1;
-                break;
-            }
-        }
-        
-        if (genre_found) {
-            found = 1;
-            json_t *id = json_object_get(movie, "id");
-            json_t *title = json_object_get(movie, "title");
-            json_t *director = json_object_get(movie, "director");
-            json_t *year = json_object_get(movie, "year");
-            
-            char movie_info[1024];
-            sprintf(movie_info, "\nID: %d\nTítulo: %s\nDiretor: %s\nAno: %d\n", 
-                    (int)json_integer_value(id), 
-                    json_string_value(title),
-                    json_string_value(director),
-                    (int)json_integer_value(year));
-            
-            strcat(response, movie_info);
+        if (matches[index]) {
+            append_movie_summary(&response, movie);
         }
     }
     
     if (!found) {
-        strcat(response, "\nNenhum filme encontrado com esse gênero.\n");
+        text_buffer_printf(&response, "%s", empty_message);
     }
     
-    json_decref(root);
-    db_unlock();
-    return response;
-}
\ No newline at end of file
+    text_pattern_free(&pattern);
+    free(matches);
+    TRACE_END(span, "format_response");
+    catalog_release(version);
+    return text_buffer_finish(&response);
+}
+
+// Lista todos os filmes de um determinado gênero
+char* list_movies_by_genre(const char *genre) {
+    return list_matching_movies(genre, 1, "Filmes do gênero '%s':\n===================\n",
+                                "\nNenhum filme encontrado com esse gênero.\n");
+}
+
+// Lista os filmes cujo título contém o texto informado
+char* search_movies_by_title(const char *text) {
+    return list_matching_movies(text, 0, "Filmes com '%s' no título:\n===================\n",
+                                "\nNenhum filme encontrado com esse título.\n");
+}
+
+// Títulos das respostas agregadas, por dimensão
+static const char *aggregate_titles[AGGREGATE_DIMENSIONS] = {"gênero", "diretor", "década"};
+
+// Lista as limit chaves com mais filmes (todas, se limit for 0), sem percorrer o catálogo
+char* top_aggregates(aggregate_dimension dimension, size_t limit) {
+    catalog_version *version = acquire_catalog();
+    if (!version) {
+        return NULL;
+    }
+    
+    aggregates_lock();
+    int ready = aggregates_current(version) || aggregates_rebuild(version);
+    catalog_release(version);
+    if (!ready) {
+        pthread_mutex_unlock(&aggregates_mutex);
+        return NULL;
+    }
+    
+    aggregate_table *table = &aggregates[dimension];
+    
+    TRACE_BEGIN(span);
+    text_buffer response;
+    if (text_buffer_init(&response, 1024) != 0) {
+        pthread_mutex_unlock(&aggregates_mutex);
+        return NULL;
+    }
+    
+    text_buffer_printf(&response, "Filmes por %s:\n===================\n", aggregate_titles[dimension]);
+    
+    // As entradas estão em ordem decrescente; as de contagem zero ficam no final
+    size_t listed = 0;
+    while (listed < table->count && (limit == 0 || listed < limit) && table->order[listed]->count > 0) {
+        aggregate_entry *entry = table->order[listed];
+        text_buffer_printf(&response, "%s | %zu\n", entry->label, entry->count);
+        listed++;
+    }
+    
+    if (listed == 0) {
+        text_buffer_printf(&response, "Nenhum filme cadastrado.\n");
+    }
+    
+    TRACE_END(span, "format_response");
+    pthread_mutex_unlock(&aggregates_mutex);
+    return text_buffer_finish(&response);
+}
+
+// Informa quantos filmes têm um gênero, um diretor ou um ano da década (ex.: "1990" ou "1994")
+char* count_aggregate(aggregate_dimension dimension, const char *value) {
+    char decade[32];
+    if (dimension == AGGREGATE_DECADE) {
+        int start = decade_of(atoi(value));
+        snprintf(decade, sizeof(decade), "%d-%d", start, start + 9);
+        value = decade;
+    }
+    
+    catalog_version *version = acquire_catalog();
+    if (!version) {
+        return NULL;
+    }
+    
+    aggregates_lock();
+    int ready = aggregates_current(version) || aggregates_rebuild(version);
+    catalog_release(version);
+    if (!ready) {
+        pthread_mutex_unlock(&aggregates_mutex);
+        return NULL;
+    }
+    
+    aggregate_entry *entry = aggregate_table_find(&aggregates[dimension], value);
+    size_t count = entry ? entry->count : 0;
+    
+    text_buffer response;
+    if (text_buffer_init(&response, 256) != 0) {
+        pthread_mutex_unlock(&aggregates_mutex);
+        return NULL;
+    }
+    
+    text_buffer_printf(&response, "%s (%s): %zu filme(s)", entry ? entry->label : value,
+                       aggregate_titles[dimension], count);
+    
+    pthread_mutex_unlock(&aggregates_mutex);
+    return text_buffer_finish(&response);
+}
@@ -15,14 +15,60 @@ int add_movie(const char *title, const char *genres, const char *director, int y
 int add_genre_to_movie(int id, const char *genre);
 int remove_movie(int id);
 
+// Tipos de operação aceitos em uma transação
+typedef enum {
+    DB_OP_ADD_MOVIE = 1,
+    DB_OP_ADD_GENRE = 2,
+    DB_OP_REMOVE_MOVIE = 3
+} db_operation_type;
+
+// Operação de escrita de uma transação; id_ref (a partir de 1) indica que o ID
+// vem do filme cadastrado por uma operação anterior do mesmo lote
+typedef struct {
+    db_operation_type type;
+    const char *title;
+    const char *genres;
+    const char *director;
+    int year;
+    int id;
+    int id_ref;
+    const char *genre;
+    int result;
+} db_operation;
+
+// Aplica todas as operações de forma atômica; em caso de falha nenhuma é aplicada
+int apply_transaction(db_operation *ops, size_t count, size_t *failed_index);
+
 // Funções para as operações de leitura
 char* list_all_titles();
 char* list_all_movies();
 char* get_movie_by_id(int id);
 char* list_movies_by_genre(const char *genre);
+char* search_movies_by_title(const char *text);
+
+// Dimensões das consultas agregadas
+typedef enum {
+    AGGREGATE_GENRE = 0,
+    AGGREGATE_DIRECTOR = 1,
+    AGGREGATE_DECADE = 2
+} aggregate_dimension;
+
+#define AGGREGATE_DIMENSIONS 3
+
+// Consultas agregadas, respondidas por contadores mantidos pelas operações de escrita
+char* top_aggregates(aggregate_dimension dimension, size_t limit);
+char* count_aggregate(aggregate_dimension dimension, const char *value);
+
+// Carrega o catálogo residente; retorna -1 se movies.json existir e for inválido
+// (o arquivo nunca é substituído nesse caso)
+int db_open();
+
+// Recarrega o catálogo residente quando o arquivo é substituído por fora do servidor
+int db_watch_start();
 
 // Funções auxiliares
 void db_lock();
 void db_unlock();
+void db_close();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "output_queue.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// Cria um novo bloco no final da fila
+static output_chunk *new_chunk(output_queue *queue, char *data, size_t length, size_t capacity) {
+    output_chunk *chunk = malloc(sizeof(output_chunk));
+    if (!chunk) {
+        return NULL;
+    }
+
+    chunk->next = NULL;
+    chunk->data = data;
+    chunk->length = length;
+    chunk->capacity = capacity;
+    chunk->offset = 0;
+
+    if (queue->tail) {
+        queue->tail->next = chunk;
+    } else {
+        queue->head = chunk;
+    }
+    queue->tail = chunk;
+    queue->pending += length;
+    return chunk;
+}
+
+// Remove o primeiro bloco da fila
+static void drop_head(output_queue *queue) {
+    output_chunk *chunk = queue->head;
+    queue->head = chunk->next;
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
+    free(chunk->data);
+    free(chunk);
+}
+
+// Inicializa uma fila vazia
+void output_queue_init(output_queue *queue) {
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->pending = 0;
+}
+
+// Libera todos os blocos ainda não enviados
+void output_queue_free(output_queue *queue) {
+    while (queue->head) {
+        drop_head(queue);
+    }
+    queue->pending = 0;
+}
+
+// Copia dados para a fila, aproveitando o espaço livre do último bloco
+int output_queue_append(output_queue *queue, const char *data, size_t length) {
+    output_chunk *tail = queue->tail;
+
+    if (length == 0) {
+        return 0;
+    }
+
+    if (tail && tail->capacity - tail->length >= length) {
+        memcpy(tail->data + tail->length, data, length);
+        tail->length += length;
+        queue->pending += length;
+        return 0;
+    }
+
+    size_t capacity = length > OUTPUT_CHUNK_SIZE ? length : OUTPUT_CHUNK_SIZE;
+    char *copy = malloc(capacity);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, data, length);
+
+    if (!new_chunk(queue, copy, length, capacity)) {
+        free(copy);
+        return -1;
+    }
+    return 0;
+}
+
+// Copia uma string terminada em '\0' para a fila
+int output_queue_append_str(output_queue *queue, const char *text) {
+    return output_queue_append(queue, text, strlen(text));
+}
+
+// Formata texto diretamente na fila
+int output_queue_printf(output_queue *queue, const char *format, ...) {
+    char line[1024];
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (length < 0) {
+        return -1;
+    }
+    if ((size_t)length < sizeof(line)) {
+        return output_queue_append(queue, line, length);
+    }
+
+    // Texto maior que o buffer local: formata em memória alocada
+    char *text = malloc(length + 1);
+    if (!text) {
+        return -1;
+    }
+    va_start(args, format);
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+
+    return output_queue_push(queue, text, length);
+}
+
+// Enfileira um buffer alocado com malloc, assumindo sua posse
+int output_queue_push(output_queue *queue, char *data, size_t length) {
+    // Respostas pequenas são copiadas para agrupar em menos blocos
+    if (length < OUTPUT_CHUNK_SIZE / 4) {
+        int result = output_queue_append(queue, data, length);
+        free(data);
+        return result;
+    }
+
+    if (!new_chunk(queue, data, length, length)) {
+        free(data);
+        return -1;
+    }
+    return 0;
+}
+
+// Encadeia os blocos de source no final da fila e deixa source vazia
+void output_queue_move(output_queue *queue, output_queue *source) {
+    if (!source->head) {
+        return;
+    }
+
+    if (queue->tail) {
+        queue->tail->next = source->head;
+    } else {
+        queue->head = source->head;
+    }
+    queue->tail = source->tail;
+    queue->pending += source->pending;
+    output_queue_init(source);
+}
+
+// Preenche iov com os blocos pendentes, sem removê-los da fila
+int output_queue_iov(const output_queue *queue, struct iovec *iov, int max) {
+    int count = 0;
+
+    for (output_chunk *chunk = queue->head; chunk && count < max; chunk = chunk->next) {
+        iov[count].iov_base = chunk->data + chunk->offset;
+        iov[count].iov_len = chunk->length - chunk->offset;
+        count++;
+    }
+    return count;
+}
+
+// Descarta os blocos enviados por completo e avança no bloco parcial
+void output_queue_consume(output_queue *queue, size_t sent) {
+    queue->pending -= sent;
+
+    while (sent > 0) {
+        output_chunk *chunk = queue->head;
+        size_t remaining = chunk->length - chunk->offset;
+        if (sent < remaining) {
+            chunk->offset += sent;
+            break;
+        }
+        sent -= remaining;
+        drop_head(queue);
+    }
+}
+
+// Envia os blocos pendentes em uma única chamada vetorizada, tratando envios parciais
+int output_queue_flush(output_queue *queue, int fd) {
+    while (queue->head) {
+        struct iovec iov[OUTPUT_MAX_IOV];
+        int count = output_queue_iov(queue, iov, OUTPUT_MAX_IOV);
+
+        // sendmsg equivale a writev, mas permite evitar SIGPIPE se o cliente fechar o socket
+        struct msghdr message = {0};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+
+        ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            return -1;
+        }
+
+        output_queue_consume(queue, sent);
+    }
+    return 1;
+}
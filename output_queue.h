@@ -0,0 +1,58 @@
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// Tamanho mínimo de um bloco; respostas pequenas são agrupadas no mesmo bloco
+#define OUTPUT_CHUNK_SIZE 4096
+
+// Acima deste volume pendente a conexão deixa de ler novas requisições
+#define OUTPUT_HIGH_WATER (256 * 1024)
+
+// Abaixo deste volume pendente a leitura é retomada
+#define OUTPUT_LOW_WATER (64 * 1024)
+
+// Número máximo de blocos enviados em uma única chamada a writev
+#define OUTPUT_MAX_IOV 64
+
+// Bloco de dados aguardando envio
+typedef struct output_chunk {
+    struct output_chunk *next;
+    char *data;
+    size_t length;
+    size_t capacity;
+    size_t offset;
+} output_chunk;
+
+// Fila de saída de uma conexão
+typedef struct {
+    output_chunk *head;
+    output_chunk *tail;
+    size_t pending;
+} output_queue;
+
+// Inicializa e libera a fila
+void output_queue_init(output_queue *queue);
+void output_queue_free(output_queue *queue);
+
+// Funções para enfileirar dados (retornam 0 em caso de sucesso e -1 em caso de erro)
+int output_queue_append(output_queue *queue, const char *data, size_t length);
+int output_queue_append_str(output_queue *queue, const char *text);
+int output_queue_printf(output_queue *queue, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+int output_queue_push(output_queue *queue, char *data, size_t length);
+
+// Transfere todos os blocos de source para o final da fila, sem copiar os dados
+void output_queue_move(output_queue *queue, output_queue *source);
+
+// Funções para backends que enviam os dados por conta própria (io_uring)
+int output_queue_iov(const output_queue *queue, struct iovec *iov, int max);
+void output_queue_consume(output_queue *queue, size_t sent);
+
+// Envia o máximo possível com sendmsg (equivalente a writev); retorna 1 se a fila esvaziou,
+// 0 se o socket não aceita mais dados no momento (EAGAIN) e -1 em caso de erro
+int output_queue_flush(output_queue *queue, int fd);
+
+#endif
@@ -0,0 +1,103 @@
+#include "rate_limit.h"
+
+#include <string.h>
+
+// Inicializa o balde cheio
+void token_bucket_init(token_bucket *bucket, double rate_per_second, double capacity, uint64_t now_ms) {
+    bucket->tokens = capacity;
+    bucket->capacity = capacity;
+    bucket->rate_per_ms = rate_per_second / 1000.0;
+    bucket->last_refill_ms = now_ms;
+}
+
+// Repõe as fichas pelo tempo decorrido e tenta consumir uma
+int token_bucket_take(token_bucket *bucket, uint64_t now_ms) {
+    if (now_ms > bucket->last_refill_ms) {
+        bucket->tokens += (now_ms - bucket->last_refill_ms) * bucket->rate_per_ms;
+        if (bucket->tokens > bucket->capacity) {
+            bucket->tokens = bucket->capacity;
+        }
+        bucket->last_refill_ms = now_ms;
+    }
+
+    if (bucket->tokens < 1.0) {
+        return 0;
+    }
+    bucket->tokens -= 1.0;
+    return 1;
+}
+
+// Hash FNV-1a do endereço e da instância
+static uint32_t peer_hash(const peer_key *key) {
+    uint32_t hash = 2166136261u ^ (uint32_t)key->family;
+    for (size_t i = 0; i < sizeof(key->address); i++) {
+        hash = (hash ^ key->address[i]) * 16777619u;
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+        hash = (hash ^ ((key->instance >> shift) & 0xff)) * 16777619u;
+    }
+    return hash;
+}
+
+// Indica se duas chaves identificam o mesmo cliente
+static int same_peer(const peer_key *a, const peer_key *b) {
+    return a->family == b->family && a->instance == b->instance && a->local == b->local &&
+           memcmp(a->address, b->address, sizeof(a->address)) == 0;
+}
+
+// Indica se o balde já teria se enchido, equivalendo a um balde novo
+static int token_bucket_idle(const token_bucket *bucket, uint64_t now_ms) {
+    uint64_t elapsed = now_ms > bucket->last_refill_ms ? now_ms - bucket->last_refill_ms : 0;
+    return bucket->tokens + elapsed * bucket->rate_per_ms >= bucket->capacity;
+}
+
+// Encontra a posição do cliente ou escolhe uma para ele: a primeira livre, senão
+// a de um cliente com o balde cheio, senão a usada há mais tempo
+static peer_slot *peer_limiter_slot(peer_limiter *limiter, const peer_key *key, uint64_t now_ms) {
+    uint32_t start = peer_hash(key);
+    peer_slot *free_slot = NULL;
+    peer_slot *victim = NULL;
+    int victim_idle = 0;
+
+    for (int i = 0; i < PEER_LIMITER_PROBES; i++) {
+        peer_slot *slot = &limiter->slots[(start + i) % PEER_LIMITER_SLOTS];
+        if (!slot->used) {
+            free_slot = free_slot ? free_slot : slot;
+            continue;
+        }
+        if (same_peer(&slot->key, key)) {
+            return slot;
+        }
+
+        int idle = token_bucket_idle(&slot->bucket, now_ms);
+        if (!victim || idle > victim_idle ||
+            (idle == victim_idle && slot->bucket.last_refill_ms < victim->bucket.last_refill_ms)) {
+            victim = slot;
+            victim_idle = idle;
+        }
+    }
+
+    victim = free_slot ? free_slot : victim;
+    victim->used = 1;
+    victim->key = *key;
+    token_bucket_init(&victim->bucket, limiter->rate_per_second, limiter->capacity, now_ms);
+    return victim;
+}
+
+// Define a taxa e a rajada antes de o limite entrar em uso
+void peer_limiter_configure(peer_limiter *limiter, double rate_per_second, double burst) {
+    limiter->rate_per_second = rate_per_second;
+    limiter->capacity = burst;
+}
+
+// Consome uma ficha do balde do cliente
+int peer_limiter_take(peer_limiter *limiter, const peer_key *key, uint64_t now_ms) {
+    if (limiter->rate_per_second <= 0) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&limiter->mutex);
+    int allowed = token_bucket_take(&peer_limiter_slot(limiter, key, now_ms)->bucket, now_ms);
+    pthread_mutex_unlock(&limiter->mutex);
+    return allowed;
+}
@@ -0,0 +1,62 @@
+#ifndef RATE_LIMIT_H
+#define RATE_LIMIT_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+// Número de clientes distintos acompanhados pelo limite por endereço
+#define PEER_LIMITER_SLOTS 4096
+
+// Posições examinadas a partir do hash de um endereço
+#define PEER_LIMITER_PROBES 8
+
+// Balde de fichas: cada requisição consome uma ficha, reposta a uma taxa fixa
+typedef struct {
+    double tokens;
+    double capacity;
+    double rate_per_ms;
+    uint64_t last_refill_ms;
+} token_bucket;
+
+// Inicializa o balde cheio, com a taxa em fichas por segundo
+void token_bucket_init(token_bucket *bucket, double rate_per_second, double capacity, uint64_t now_ms);
+
+// Consome uma ficha; retorna 1 se a requisição pode prosseguir e 0 se deve ser recusada
+int token_bucket_take(token_bucket *bucket, uint64_t now_ms);
+
+// Identifica um cliente: o endereço IPv4 ou IPv6 de um cliente remoto; em clientes
+// locais, instance distingue cada processo (socket Unix) ou conexão (loopback)
+typedef struct {
+    int family;
+    unsigned char address[16];
+    uint32_t instance;
+    int local;
+} peer_key;
+
+typedef struct {
+    int used;
+    peer_key key;
+    token_bucket bucket;
+} peer_slot;
+
+// Baldes por cliente, compartilhados por todas as suas conexões: reconectar não
+// devolve as fichas. Quando as posições de um endereço estão todas ocupadas, é
+// reaproveitada a de um cliente que já teria o balde cheio (ou a menos recente).
+// Com taxa zero, não há limite.
+typedef struct {
+    pthread_mutex_t mutex;
+    double rate_per_second;
+    double capacity;
+    peer_slot slots[PEER_LIMITER_SLOTS];
+} peer_limiter;
+
+#define PEER_LIMITER_INITIALIZER(rate, burst) \
+    {.mutex = PTHREAD_MUTEX_INITIALIZER, .rate_per_second = (rate), .capacity = (burst)}
+
+// Altera a taxa e a rajada; só pode ser chamada antes de o limite entrar em uso
+void peer_limiter_configure(peer_limiter *limiter, double rate_per_second, double burst);
+
+// Consome uma ficha do balde do cliente; retorna 1 se a requisição pode prosseguir
+int peer_limiter_take(peer_limiter *limiter, const peer_key *key, uint64_t now_ms);
+
+#endif
@@ -2,27 +2,142 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <pthread.h>
 #include "json_operations.h"
+#include "connection.h"
+#include "uring_backend.h"
+#include "shm_transport.h"
+#include "shm_ring.h"
+#include "trace.h"
 #include <asm-generic/socket.h>
 
 #define PORT 49153
+#define SOCKET_PATH "/tmp/movies.sock"
 #define BUFFER_SIZE 4096
+#define MAX_TRANSACTION_OPS 64
 
 // Função para tratar as requisições do cliente
-void process_request(char *request, char *response);
+void process_request(char *request, output_queue *out);
 
 // Função executada por cada thread para atender um cliente
 void *handle_client(void *client_socket);
 
-int main()
+// Backend de rede com uma thread por cliente
+static void run_thread_backend(const int *listen_fds, int listen_count);
+
+// Processa as requisições lidas de um cliente (compartilhada pelos backends)
+static int process_input(connection *conn, char *data);
+
+// Pipe que se torna legível quando o servidor recebe SIGTERM ou SIGINT;
+// nunca é esvaziado, então acorda todas as threads que o observam
+static int shutdown_pipe[2];
+
+// Tratador de sinais: apenas notifica o loop principal e as threads
+static void handle_shutdown_signal(int signum)
+{
+    (void)signum;
+    int saved_errno = errno;
+    ssize_t ignored = write(shutdown_pipe[1], "x", 1);
+    (void)ignored;
+    errno = saved_errno;
+}
+
+// Instala os tratadores de SIGTERM e SIGINT
+static int setup_shutdown_signals()
+{
+    if (pipe(shutdown_pipe) != 0)
+    {
+        return -1;
+    }
+    fcntl(shutdown_pipe[1], F_SETFL, O_NONBLOCK);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_shutdown_signal;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGTERM, &action, NULL) != 0 || sigaction(SIGINT, &action, NULL) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// Interpreta "TAXA[,RAJADA]" (requisições por segundo); sem rajada, ela vale o dobro da taxa
+static int parse_rate_limit(const char *text, double *rate, double *burst)
+{
+    char *end;
+    *rate = strtod(text, &end);
+    *burst = *rate * 2;
+    if (end != text && *end == ',')
+    {
+        const char *burst_text = end + 1;
+        *burst = strtod(burst_text, &end);
+        if (end == burst_text)
+        {
+            return -1;
+        }
+    }
+    if (end == text || *end != '\0' || *rate < 0 || (*rate > 0 && *burst < 1))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
 {
-    int server_fd, client_socket;
+    int server_fd, unix_fd;
     struct sockaddr_in address;
+    struct stat unix_file;
     int opt = 1;
-    int addrlen = sizeof(address);
+    int use_uring = 0;
+
+    // Escolhe o backend de rede: "--backend=threads" (padrão) ou "--backend=uring"; os
+    // limites de requisições de clientes remotos e locais podem ser alterados (0 desativa)
+    for (int i = 1; i < argc; i++)
+    {
+        double rate, burst;
+        int local = strncmp(argv[i], "--local-rate-limit=", 19) == 0;
+
+        if (strcmp(argv[i], "--backend=uring") == 0)
+        {
+            use_uring = 1;
+        }
+        else if (strcmp(argv[i], "--backend=threads") == 0)
+        {
+            use_uring = 0;
+        }
+        else if ((local || strncmp(argv[i], "--rate-limit=", 13) == 0) &&
+                 parse_rate_limit(strchr(argv[i], '=') + 1, &rate, &burst) == 0)
+        {
+            connection_set_rate_limit(local, rate, burst);
+        }
+        else
+        {
+            fprintf(stderr,
+                    "Uso: %s [--backend=threads|--backend=uring] [--rate-limit=TAXA[,RAJADA]] "
+                    "[--local-rate-limit=TAXA[,RAJADA]]\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Clientes na mesma máquina podem usar um socket Unix, sem passar pela pilha TCP. Ele é
+    // criado antes do socket TCP: como a porta usa SO_REUSEPORT, só o caminho do socket
+    // Unix revela outro servidor em execução, e este não deve chegar a aceitar conexões TCP
+    if ((unix_fd = unix_listen(SOCKET_PATH, &unix_file)) < 0)
+    {
+        perror(errno == EADDRINUSE ? "Outro servidor já atende em " SOCKET_PATH : "Falha ao criar socket Unix");
+        exit(EXIT_FAILURE);
+    }
 
     // Cria o socket do servidor
     if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0)
@@ -51,24 +166,144 @@ int main()
     }
 
     // Configura o socket para escutar conexões
-    if (listen(server_fd, 10) < 0)
+    if (listen(server_fd, LISTEN_BACKLOG) < 0)
     {
         perror("Falha ao escutar");
         exit(EXIT_FAILURE);
     }
 
-    printf("Servidor iniciado. Aguardando conexões na porta %d...\n", PORT);
+    // Carrega o catálogo antes de aceitar clientes; um movies.json inválido não é
+    // sobrescrito, e o servidor não inicia até que ele seja corrigido
+    if (db_open() != 0)
+    {
+        fprintf(stderr, "Falha ao carregar o banco de dados; corrija movies.json e inicie o servidor novamente\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Recarrega o catálogo quando movies.json for substituído por fora do servidor
+    if (db_watch_start() != 0)
+    {
+        perror("Falha ao observar o banco de dados; a recarga automática está desativada");
+    }
+
+    // Inicia o monitoramento de clientes ociosos
+    if (idle_monitor_start() != 0)
+    {
+        perror("Falha ao iniciar monitor de inatividade");
+        exit(EXIT_FAILURE);
+    }
+
+    // Instala o tratamento de SIGTERM/SIGINT para encerramento gracioso
+    if (setup_shutdown_signals() != 0)
+    {
+        perror("Falha ao configurar sinais");
+        exit(EXIT_FAILURE);
+    }
+
+#ifdef TRACE_ENABLED
+    // Grava o rastreamento das requisições em TRACE_DUMP_PATH a cada SIGUSR1
+    if (trace_signal_start(SIGUSR1) != 0)
+    {
+        perror("Falha ao configurar o rastreamento");
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+    // Inicia o transporte por memória compartilhada para clientes locais
+    if (shm_transport_start(shutdown_pipe[0], process_input) != 0)
+    {
+        perror("Falha ao iniciar transporte por memória compartilhada");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Servidor iniciado. Aguardando conexões na porta %d, em %s e em %s...\n",
+           PORT, SOCKET_PATH, SHM_SOCKET_PATH);
+
+    // Executa o backend escolhido; sem io_uring disponível, usa uma thread por cliente
+    int listen_fds[] = {server_fd, unix_fd};
+    if (!use_uring || uring_backend_run(listen_fds, 2, shutdown_pipe[0], process_input) != 0)
+    {
+        if (use_uring)
+        {
+            fprintf(stderr, "io_uring indisponível, usando uma thread por cliente\n");
+        }
+        run_thread_backend(listen_fds, 2);
+        printf("Encerrando servidor...\n");
+    }
+
+    // Para de aceitar conexões e aguarda as requisições em andamento
+    close(server_fd);
+    close(unix_fd);
+    unix_unlink(SOCKET_PATH, &unix_file);
+    shm_transport_stop();
+
+    if (connection_wait_all(SHUTDOWN_DRAIN_MS) != 0)
+    {
+        fprintf(stderr, "Prazo de encerramento esgotado com clientes ainda conectados\n");
+    }
+
+    // Aguarda a gravação em andamento; nenhuma escrita começa depois disso
+    db_close();
+    printf("Servidor encerrado\n");
+
+    return 0;
+}
+
+// Backend padrão: aceita conexões e cria uma thread por cliente até receber um sinal de encerramento
+static void run_thread_backend(const int *listen_fds, int listen_count)
+{
+    int client_socket;
 
-    // Loop principal para aceitar conexões
     while (1)
     {
-        // Aceita uma nova conexão
-        if ((client_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen)) < 0)
+        // O último descritor observado é o aviso de encerramento
+        struct pollfd fds[URING_MAX_LISTENERS + 1];
+        for (int i = 0; i < listen_count; i++)
+        {
+            fds[i] = (struct pollfd){.fd = listen_fds[i], .events = POLLIN, .revents = 0};
+        }
+        fds[listen_count] = (struct pollfd){.fd = shutdown_pipe[0], .events = POLLIN, .revents = 0};
+
+        if (poll(fds, listen_count + 1, -1) < 0)
+        {
+            if (errno != EINTR)
+            {
+                perror("Falha ao aguardar conexões");
+            }
+            continue;
+        }
+
+        if (fds[listen_count].revents & POLLIN)
+        {
+            break;
+        }
+
+        // Aceita uma nova conexão no primeiro socket de escuta pronto
+        int ready = 0;
+        while (ready < listen_count && !(fds[ready].revents & POLLIN))
+        {
+            ready++;
+        }
+        if (ready == listen_count)
+        {
+            continue;
+        }
+
+        if ((client_socket = accept(listen_fds[ready], NULL, NULL)) < 0)
         {
             perror("Falha ao aceitar conexão");
             continue;
         }
 
+        // Recusa o cliente de forma educada se o limite de conexões foi atingido
+        if (connection_slot_acquire() != 0)
+        {
+            const char *busy = "Erro: servidor lotado, tente novamente mais tarde";
+            send(client_socket, busy, strlen(busy) + 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+            close(client_socket);
+            continue;
+        }
+
         // Cria uma nova thread para lidar com o cliente
         pthread_t thread_id;
         int *pclient = malloc(sizeof(int));
@@ -79,6 +314,7 @@ int main()
             perror("Falha ao criar thread");
             close(client_socket);
             free(pclient);
+            connection_slot_release();
         }
         else
         {
@@ -86,7 +322,155 @@ int main()
             pthread_detach(thread_id);
         }
     }
+}
+
+// Ativa ou desativa o TCP_CORK para agrupar respostas pequenas em menos segmentos
+static void set_cork(int fd, int enabled)
+{
+    setsockopt(fd, IPPROTO_TCP, TCP_CORK, &enabled, sizeof(enabled));
+}
+
+// Ativa a compressão das respostas seguintes se o cliente aceitar algum algoritmo
+// suportado ("compress" ou "compress;alg1,alg2,..."); a resposta à negociação não é comprimida
+static void negotiate_compression(connection *conn, char *request, output_queue *out)
+{
+    if (conn->compressor)
+    {
+        output_queue_append_str(out, "Compressão já ativada: " COMPRESSION_ALGORITHM);
+        return;
+    }
+
+    char *algorithms = strchr(request, ';');
+    int accepted = !algorithms;
+    char *saveptr;
+    for (char *name = algorithms ? strtok_r(algorithms + 1, ",", &saveptr) : NULL; name && !accepted;
+         name = strtok_r(NULL, ",", &saveptr))
+    {
+        accepted = strcmp(name, COMPRESSION_ALGORITHM) == 0;
+    }
 
+    if (!accepted)
+    {
+        output_queue_append_str(out, "Erro: nenhum algoritmo de compressão suportado (disponível: " COMPRESSION_ALGORITHM ")");
+        return;
+    }
+
+    conn->compressor = response_compressor_create(COMPRESSION_LEVEL);
+    if (!conn->compressor)
+    {
+        output_queue_append_str(out, "Erro ao ativar a compressão");
+        return;
+    }
+    output_queue_append_str(out, "Compressão ativada: " COMPRESSION_ALGORITHM);
+}
+
+// Enfileira uma resposta montada à parte no quadro da compressão
+static int queue_response_frame(connection *conn, output_queue *response)
+{
+    int count = 0;
+    for (output_chunk *chunk = response->head; chunk; chunk = chunk->next)
+    {
+        count++;
+    }
+
+    struct iovec *iov = malloc((count + 1) * sizeof(struct iovec));
+    if (!iov)
+    {
+        return -1;
+    }
+
+    char *frame;
+    size_t frame_length;
+    int iovcnt = output_queue_iov(response, iov, count);
+    int failed = response_compressor_frame(conn->compressor, iov, iovcnt, &frame, &frame_length) != 0;
+    free(iov);
+
+    // output_queue_push libera o quadro se não conseguir enfileirá-lo
+    if (failed || output_queue_push(&conn->out, frame, frame_length) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// Processa as requisições completas contidas nos dados lidos; retorna 1 se o cliente pediu "exit"
+static int process_input(connection *conn, char *data)
+{
+    uint64_t now = monotonic_ms();
+
+    // Cada requisição termina em '\n'; uma linha dividida entre leituras fica
+    // guardada na conexão até que o restante chegue
+    if (connection_input_append(conn, data, strlen(data)) != 0)
+    {
+        return 1;
+    }
+
+    char *request;
+    int status;
+    while ((status = connection_next_request(conn, &request)) != 0)
+    {
+        if (status > 0 && *request == '\0')
+        {
+            continue;
+        }
+        if (status > 0 && strncmp(request, "exit", 4) == 0)
+        {
+            return 1;
+        }
+
+        TRACE_REQUEST_BEGIN(span);
+
+        // Com a compressão ativa, a resposta é montada à parte e enviada em um quadro
+        output_queue response;
+        output_queue *target = &conn->out;
+        if (conn->compressor)
+        {
+            output_queue_init(&response);
+            target = &response;
+        }
+
+        // Linhas longas demais são recusadas sem serem interpretadas; clientes acima
+        // do limite recebem erro em vez de consumir o banco de dados
+        if (status < 0)
+        {
+            output_queue_printf(target, "Erro: requisição maior que %d bytes", REQUEST_LINE_MAX);
+        }
+        else if (!connection_allow_request(conn, now))
+        {
+            output_queue_append_str(target, "Erro: limite de requisições excedido, tente novamente em instantes");
+        }
+        else if (strcmp(request, "compress") == 0 || strncmp(request, "compress;", 9) == 0)
+        {
+            negotiate_compression(conn, request, target);
+        }
+        else
+        {
+            process_request(request, target);
+        }
+
+        // Sem compressão, cada resposta termina em '\0' para que o cliente saiba
+        // onde ela acaba (respostas longas chegam em várias leituras)
+        if (target != &response)
+        {
+            output_queue_append(target, "", 1);
+        }
+        else
+        {
+            TRACE_BEGIN(compress);
+            int failed = queue_response_frame(conn, &response);
+            output_queue_free(&response);
+            TRACE_END(compress, "compress");
+
+            // O fluxo de compressão fica inconsistente após uma falha; a conexão é encerrada
+            if (failed)
+            {
+                TRACE_REQUEST_END(span);
+                return 1;
+            }
+        }
+
+        TRACE_REQUEST_END(span);
+    }
     return 0;
 }
 
@@ -95,53 +479,268 @@ void *handle_client(void *arg)
     int client_socket = *((int *)arg);
     free(arg);
 
-    char buffer[BUFFER_SIZE] = {0};
-    char response[BUFFER_SIZE] = {0};
+    char buffer[BUFFER_SIZE];
+    connection conn;
+    connection_init(&conn, client_socket);
 
-    // Loop para receber e processar mensagens do cliente
+    int reading_paused = 0;
+    int closing = 0;
+    int opt = 1;
+
+    // O socket passa a ser não bloqueante para que envios parciais não travem a thread
+    fcntl(client_socket, F_SETFL, fcntl(client_socket, F_GETFL, 0) | O_NONBLOCK);
+    setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    // Loop para receber requisições e enviar respostas ao cliente
     while (1)
     {
-        // Limpa o buffer
-        memset(buffer, 0, BUFFER_SIZE);
+        struct pollfd pfd = {.fd = client_socket, .events = 0, .revents = 0};
 
-        // Recebe dados do cliente
-        int bytes_read = read(client_socket, buffer, BUFFER_SIZE - 1);
-        if (bytes_read <= 0)
+        // Lê novas requisições apenas enquanto a fila de saída não atingir o limite
+        if (!reading_paused && !closing)
         {
-            // Cliente desconectou ou erro de leitura
+            pfd.events |= POLLIN;
+        }
+        if (conn.out.pending > 0)
+        {
+            pfd.events |= POLLOUT;
+        }
+        if (pfd.events == 0)
+        {
+            // Cliente pediu para sair (ou o servidor está encerrando) e todas as respostas foram enviadas
+            break;
+        }
+
+        // Enquanto não estiver encerrando, também observa o aviso de encerramento do servidor
+        struct pollfd fds[2] = {pfd, {.fd = shutdown_pipe[0], .events = POLLIN, .revents = 0}};
+        if (poll(fds, closing ? 1 : 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
             break;
         }
+        pfd = fds[0];
+
+        if (pfd.revents & (POLLERR | POLLNVAL))
+        {
+            break;
+        }
+
+        if (!closing && (fds[1].revents & POLLIN))
+        {
+            // Servidor encerrando: não lê novas requisições, apenas envia as respostas pendentes
+            closing = 1;
+            continue;
+        }
 
-        // Processa a requisição
-        process_request(buffer, response);
+        if (pfd.revents & (POLLIN | POLLHUP))
+        {
+            // Recebe dados do cliente
+            int bytes_read = read(client_socket, buffer, BUFFER_SIZE - 1);
+            if (bytes_read == 0)
+            {
+                // Cliente desconectou
+                break;
+            }
+            if (bytes_read < 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                {
+                    continue;
+                }
+                break;
+            }
+            buffer[bytes_read] = '\0';
+            connection_touch(&conn);
 
-        // Envia a resposta ao cliente
-        send(client_socket, response, strlen(response), 0);
+            // Agrupa as respostas de todas as requisições lidas antes de enviá-las
+            set_cork(client_socket, 1);
+            closing = process_input(&conn, buffer);
+        }
 
-        // Se o cliente enviar "exit", encerra a conexão
-        if (strncmp(buffer, "exit", 4) == 0)
+        // Envia a resposta ao cliente; progresso no envio também conta como atividade
+        size_t pending = conn.out.pending;
+        TRACE_BEGIN(send);
+        if (output_queue_flush(&conn.out, client_socket) < 0)
         {
             break;
         }
+        if (pending > 0)
+        {
+            TRACE_END_BYTES(send, "send", pending - conn.out.pending);
+        }
+        if (conn.out.pending < pending)
+        {
+            connection_touch(&conn);
+        }
+        set_cork(client_socket, 0);
+
+        // Pausa a leitura de clientes que não consomem as respostas
+        if (conn.out.pending >= OUTPUT_HIGH_WATER)
+        {
+            reading_paused = 1;
+        }
+        else if (conn.out.pending <= OUTPUT_LOW_WATER)
+        {
+            reading_paused = 0;
+        }
     }
 
-    // Fecha o socket do cliente
-    close(client_socket);
-    printf("Cliente desconectado\n");
+    // Fecha o socket do cliente e libera sua vaga
+    int timed_out = connection_timed_out(&conn);
+    connection_close(&conn);
+    connection_slot_release();
+    printf(timed_out ? "Cliente desconectado por inatividade\n" : "Cliente desconectado\n");
 
     return NULL;
 }
 
-void process_request(char *request, char *response)
+// Converte o ID de uma operação de transação; "$n" referencia a n-ésima operação do lote
+static int parse_transaction_id(const char *text, db_operation *op)
+{
+    if (text[0] == '$')
+    {
+        op->id_ref = atoi(text + 1);
+        return op->id_ref > 0 ? 0 : -1;
+    }
+
+    op->id = atoi(text);
+    return op->id > 0 ? 0 : -1;
+}
+
+// Interpreta uma operação de transação no mesmo formato dos comandos 1, 2 e 3
+static int parse_transaction_op(char *text, db_operation *op)
 {
-    // Inicializa a resposta
-    memset(response, 0, BUFFER_SIZE);
+    char *saveptr;
+    char *command = strtok_r(text, ";", &saveptr);
 
+    memset(op, 0, sizeof(*op));
+    if (!command)
+    {
+        return -1;
+    }
+
+    if (strcmp(command, "1") == 0)
+    {
+        op->type = DB_OP_ADD_MOVIE;
+        op->title = strtok_r(NULL, ";", &saveptr);
+        op->genres = strtok_r(NULL, ";", &saveptr);
+        op->director = strtok_r(NULL, ";", &saveptr);
+        char *year_str = strtok_r(NULL, ";", &saveptr);
+
+        if (!op->title || !op->genres || !op->director || !year_str)
+        {
+            return -1;
+        }
+        op->year = atoi(year_str);
+        return op->year > 0 ? 0 : -1;
+    }
+    else if (strcmp(command, "2") == 0)
+    {
+        op->type = DB_OP_ADD_GENRE;
+        char *id_str = strtok_r(NULL, ";", &saveptr);
+        op->genre = strtok_r(NULL, ";", &saveptr);
+
+        if (!id_str || !op->genre)
+        {
+            return -1;
+        }
+        return parse_transaction_id(id_str, op);
+    }
+    else if (strcmp(command, "3") == 0)
+    {
+        op->type = DB_OP_REMOVE_MOVIE;
+        char *id_str = strtok_r(NULL, ";", &saveptr);
+
+        if (!id_str)
+        {
+            return -1;
+        }
+        return parse_transaction_id(id_str, op);
+    }
+
+    return -1;
+}
+
+// Converte o nome de uma dimensão das consultas agregadas
+static int parse_aggregate_dimension(const char *text, aggregate_dimension *dimension)
+{
+    if (strcmp(text, "genero") == 0 || strcmp(text, "gênero") == 0)
+    {
+        *dimension = AGGREGATE_GENRE;
+    }
+    else if (strcmp(text, "diretor") == 0)
+    {
+        *dimension = AGGREGATE_DIRECTOR;
+    }
+    else if (strcmp(text, "decada") == 0 || strcmp(text, "década") == 0)
+    {
+        *dimension = AGGREGATE_DECADE;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// Executa um lote de operações separadas por '|' como uma única transação
+static void process_transaction(char *batch, output_queue *out)
+{
+    db_operation ops[MAX_TRANSACTION_OPS];
+    size_t count = 0;
+    char *saveptr;
+
+    for (char *text = strtok_r(batch, "|", &saveptr); text; text = strtok_r(NULL, "|", &saveptr))
+    {
+        if (count == MAX_TRANSACTION_OPS)
+        {
+            output_queue_printf(out, "Erro: transação com mais de %d operações", MAX_TRANSACTION_OPS);
+            return;
+        }
+        if (parse_transaction_op(text, &ops[count]) != 0)
+        {
+            output_queue_printf(out, "Erro: operação %zu da transação inválida", count + 1);
+            return;
+        }
+        count++;
+    }
+
+    if (count == 0)
+    {
+        output_queue_append_str(out, "Erro: nenhuma operação fornecida");
+        return;
+    }
+
+    size_t failed_index = 0;
+    if (!apply_transaction(ops, count, &failed_index))
+    {
+        output_queue_printf(out, "Erro: operação %zu da transação falhou; nenhuma alteração foi aplicada",
+                            failed_index + 1);
+        return;
+    }
+
+    output_queue_printf(out, "Transação aplicada com sucesso (%zu operações)", count);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (ops[i].type == DB_OP_ADD_MOVIE)
+        {
+            output_queue_printf(out, "\nOperação %zu: filme cadastrado com ID %d", i + 1, ops[i].result);
+        }
+    }
+}
+
+void process_request(char *request, output_queue *out)
+{
     // Tokeniza a requisição para obter o comando e os parâmetros
-    char *command = strtok(request, ";");
+    // (strtok_r, pois várias threads processam requisições ao mesmo tempo)
+    char *saveptr;
+    char *command = strtok_r(request, ";", &saveptr);
     if (!command)
     {
-        strcpy(response, "Erro: comando inválido");
+        output_queue_append_str(out, "Erro: comando inválido");
         return;
     }
 
@@ -149,82 +748,90 @@ void process_request(char *request, char *response)
     if (strcmp(command, "1") == 0)
     {
         // Cadastrar um novo filme
-        char *title = strtok(NULL, ";");
-        char *genres = strtok(NULL, ";");
-        char *director = strtok(NULL, ";");
-        char *year_str = strtok(NULL, ";");
+        char *title = strtok_r(NULL, ";", &saveptr);
+        char *genres = strtok_r(NULL, ";", &saveptr);
+        char *director = strtok_r(NULL, ";", &saveptr);
+        char *year_str = strtok_r(NULL, ";", &saveptr);
 
         if (!title || !genres || !director || !year_str)
         {
-            strcpy(response, "Erro: parâmetros insuficientes");
+            output_queue_append_str(out, "Erro: parâmetros insuficientes");
             return;
         }
 
         int year = atoi(year_str);
         if (year <= 0)
         {
-            strcpy(response, "Erro: ano inválido");
+            output_queue_append_str(out, "Erro: ano inválido");
             return;
         }
 
+        // Sem ID, a escrita foi recusada (por exemplo, movies.json inválido)
         int id = add_movie(title, genres, director, year);
-        sprintf(response, "Filme cadastrado com sucesso. ID: %d", id);
+        if (id > 0)
+        {
+            output_queue_printf(out, "Filme cadastrado com sucesso. ID: %d", id);
+        }
+        else
+        {
+            output_queue_append_str(out, "Erro: não foi possível cadastrar o filme");
+        }
     }
     else if (strcmp(command, "2") == 0)
     {
         // Adicionar um novo gênero a um filme
-        char *id_str = strtok(NULL, ";");
-        char *genre = strtok(NULL, ";");
+        char *id_str = strtok_r(NULL, ";", &saveptr);
+        char *genre = strtok_r(NULL, ";", &saveptr);
 
         if (!id_str || !genre)
         {
-            strcpy(response, "Erro: parâmetros insuficientes");
+            output_queue_append_str(out, "Erro: parâmetros insuficientes");
             return;
         }
 
         int id = atoi(id_str);
         if (id <= 0)
         {
-            strcpy(response, "Erro: ID inválido");
+            output_queue_append_str(out, "Erro: ID inválido");
             return;
         }
 
         int success = add_genre_to_movie(id, genre);
         if (success)
         {
-            sprintf(response, "Gênero '%s' adicionado ao filme ID %d", genre, id);
+            output_queue_printf(out, "Gênero '%s' adicionado ao filme ID %d", genre, id);
         }
         else
         {
-            sprintf(response, "Erro: filme ID %d não encontrado ou gênero já existente", id);
+            output_queue_printf(out, "Erro: filme ID %d não encontrado ou gênero já existente", id);
         }
     }
     else if (strcmp(command, "3") == 0)
     {
         // Remover um filme pelo identificador
-        char *id_str = strtok(NULL, ";");
+        char *id_str = strtok_r(NULL, ";", &saveptr);
 
         if (!id_str)
         {
-            strcpy(response, "Erro: ID não fornecido");
+            output_queue_append_str(out, "Erro: ID não fornecido");
             return;
         }
 
         int id = atoi(id_str);
         if (id <= 0)
         {
-            strcpy(response, "Erro: ID inválido");
+            output_queue_append_str(out, "Erro: ID inválido");
             return;
         }
 
         int success = remove_movie(id);
         if (success)
         {
-            sprintf(response, "Filme ID %d removido com sucesso", id);
+            output_queue_printf(out, "Filme ID %d removido com sucesso", id);
         }
         else
         {
-            sprintf(response, "Erro: filme ID %d não encontrado", id);
+            output_queue_printf(out, "Erro: filme ID %d não encontrado", id);
         }
     }
     else if (strcmp(command, "4") == 0)
@@ -233,12 +840,11 @@ void process_request(char *request, char *response)
         char *titles = list_all_titles();
         if (titles)
         {
-            strcpy(response, titles);
-            free(titles);
+            output_queue_push(out, titles, strlen(titles));
         }
         else
         {
-            strcpy(response, "Erro ao listar títulos");
+            output_queue_append_str(out, "Erro ao listar títulos");
         }
     }
     else if (strcmp(command, "5") == 0)
@@ -247,80 +853,188 @@ void process_request(char *request, char *response)
         char *movies = list_all_movies();
         if (movies)
         {
-            strcpy(response, movies);
-            free(movies);
+            output_queue_push(out, movies, strlen(movies));
         }
         else
         {
-            strcpy(response, "Erro ao listar filmes");
+            output_queue_append_str(out, "Erro ao listar filmes");
         }
     }
     else if (strcmp(command, "6") == 0)
     {
         // Listar informações de um filme específico
-        char *id_str = strtok(NULL, ";");
+        char *id_str = strtok_r(NULL, ";", &saveptr);
 
         if (!id_str)
         {
-            strcpy(response, "Erro: ID não fornecido");
+            output_queue_append_str(out, "Erro: ID não fornecido");
             return;
         }
 
         int id = atoi(id_str);
         if (id <= 0)
         {
-            strcpy(response, "Erro: ID inválido");
+            output_queue_append_str(out, "Erro: ID inválido");
             return;
         }
 
         char *movie = get_movie_by_id(id);
         if (movie)
         {
-            strcpy(response, movie);
-            free(movie);
+            output_queue_push(out, movie, strlen(movie));
         }
         else
         {
-            strcpy(response, "Erro ao buscar filme");
+            output_queue_append_str(out, "Erro ao buscar filme");
         }
     }
     else if (strcmp(command, "7") == 0)
     {
         // Listar todos os filmes de um determinado gênero
-        char *genre = strtok(NULL, ";");
+        char *genre = strtok_r(NULL, ";", &saveptr);
 
         if (!genre)
         {
-            strcpy(response, "Erro: gênero não fornecido");
+            output_queue_append_str(out, "Erro: gênero não fornecido");
             return;
         }
 
         char *movies = list_movies_by_genre(genre);
         if (movies)
         {
-            strcpy(response, movies);
-            free(movies);
+            output_queue_push(out, movies, strlen(movies));
+        }
+        else
+        {
+            output_queue_append_str(out, "Erro ao listar filmes por gênero");
+        }
+    }
+    else if (strcmp(command, "8") == 0)
+    {
+        // Executar várias operações de escrita de forma atômica
+        char *batch = strtok_r(NULL, "", &saveptr);
+
+        if (!batch)
+        {
+            output_queue_append_str(out, "Erro: nenhuma operação fornecida");
+            return;
+        }
+
+        process_transaction(batch, out);
+    }
+    else if (strcmp(command, "9") == 0)
+    {
+        // Buscar filmes por parte do título
+        char *text = strtok_r(NULL, ";", &saveptr);
+
+        if (!text)
+        {
+            output_queue_append_str(out, "Erro: texto de busca não fornecido");
+            return;
+        }
+
+        char *movies = search_movies_by_title(text);
+        if (movies)
+        {
+            output_queue_push(out, movies, strlen(movies));
+        }
+        else
+        {
+            output_queue_append_str(out, "Erro ao buscar filmes por título");
+        }
+    }
+    else if (strcmp(command, "10") == 0)
+    {
+        // Listar as chaves com mais filmes em uma dimensão
+        char *dimension_str = strtok_r(NULL, ";", &saveptr);
+        char *limit_str = strtok_r(NULL, ";", &saveptr);
+        aggregate_dimension dimension;
+
+        if (!dimension_str || parse_aggregate_dimension(dimension_str, &dimension) != 0)
+        {
+            output_queue_append_str(out, "Erro: dimensão inválida (use genero, diretor ou decada)");
+            return;
+        }
+
+        int limit = limit_str ? atoi(limit_str) : 0;
+        char *result = top_aggregates(dimension, limit > 0 ? (size_t)limit : 0);
+        if (result)
+        {
+            output_queue_push(out, result, strlen(result));
+        }
+        else
+        {
+            output_queue_append_str(out, "Erro ao consultar os totais");
+        }
+    }
+    else if (strcmp(command, "11") == 0)
+    {
+        // Contar os filmes de um gênero, diretor ou década
+        char *dimension_str = strtok_r(NULL, ";", &saveptr);
+        char *value = strtok_r(NULL, ";", &saveptr);
+        aggregate_dimension dimension;
+
+        if (!dimension_str || parse_aggregate_dimension(dimension_str, &dimension) != 0)
+        {
+            output_queue_append_str(out, "Erro: dimensão inválida (use genero, diretor ou decada)");
+            return;
+        }
+        if (!value)
+        {
+            output_queue_append_str(out, "Erro: valor não fornecido");
+            return;
+        }
+
+        char *result = count_aggregate(dimension, value);
+        if (result)
+        {
+            output_queue_push(out, result, strlen(result));
+        }
+        else
+        {
+            output_queue_append_str(out, "Erro ao consultar os totais");
+        }
+    }
+    else if (strcmp(command, "trace") == 0)
+    {
+        // Exportar o rastreamento das requisições (formato JSON do Chrome trace / Perfetto)
+#ifdef TRACE_ENABLED
+        char *trace = trace_dump_json();
+        if (trace)
+        {
+            output_queue_push(out, trace, strlen(trace));
         }
         else
         {
-            strcpy(response, "Erro ao listar filmes por gênero");
+            output_queue_append_str(out, "Erro ao exportar o rastreamento");
         }
+#else
+        output_queue_append_str(out, "Erro: rastreamento desativado nesta compilação (use make TRACE=1)");
+#endif
     }
     else if (strcmp(command, "help") == 0)
     {
         // Exibe ajuda com os comandos disponíveis
-        strcpy(response, "Comandos disponíveis:\n\n"
-                         "1;título;gêneros;diretor;ano - Cadastrar novo filme\n"
-                         "2;id;gênero - Adicionar gênero a um filme\n"
-                         "3;id - Remover filme\n"
-                         "4 - Listar todos os títulos de filmes\n"
-                         "5 - Listar informações de todos os filmes\n"
-                         "6;id - Listar informações de um filme específico\n"
-                         "7;gênero - Listar todos os filmes de um gênero\n"
-                         "exit - Encerrar conexão\n");
+        output_queue_append_str(out, "Comandos disponíveis:\n\n"
+                                     "1;título;gêneros;diretor;ano - Cadastrar novo filme\n"
+                                     "2;id;gênero - Adicionar gênero a um filme\n"
+                                     "3;id - Remover filme\n"
+                                     "4 - Listar todos os títulos de filmes\n"
+                                     "5 - Listar informações de todos os filmes\n"
+                                     "6;id - Listar informações de um filme específico\n"
+                                     "7;gênero - Listar todos os filmes de um gênero\n"
+                                     "8;op|op|... - Executar operações 1, 2 e 3 como uma transação\n"
+                                     "              ($n usa o ID do filme cadastrado pela n-ésima operação)\n"
+                                     "9;texto - Buscar filmes pelo título\n"
+                                     "10;dimensão[;n] - Listar os n gêneros, diretores ou décadas com mais filmes\n"
+                                     "11;dimensão;valor - Contar os filmes de um gênero, diretor ou década\n"
+                                     "              (dimensão: genero, diretor ou decada)\n"
+                                     "compress[;algoritmos] - Comprimir as respostas seguintes (" COMPRESSION_ALGORITHM ")\n"
+                                     "trace - Exportar o rastreamento das requisições (JSON do Chrome trace / Perfetto)\n"
+                                     "exit - Encerrar conexão\n");
     }
     else
     {
-        strcpy(response, "Comando não reconhecido. Digite 'help' para ver os comandos disponíveis.");
+        output_queue_append_str(out, "Comando não reconhecido. Digite 'help' para ver os comandos disponíveis.");
     }
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+#define _GNU_SOURCE
+#include "shm_ring.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Iterações de espera ativa antes de dormir no futex
+#define SHM_SPIN_COUNT 2000
+
+#define RING_MASK (SHM_RING_CAPACITY - 1)
+
+// Futex compartilhado entre processos (a memória é mapeada com MAP_SHARED)
+static int futex_wait(uint32_t *address, uint32_t expected, int timeout_ms) {
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    return (int)syscall(SYS_futex, address, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+static void futex_wake(uint32_t *address) {
+    syscall(SYS_futex, address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Avisa o outro lado, acordando-o apenas se estiver dormindo
+static void notify(uint32_t *seq, uint32_t *waiting) {
+    __atomic_fetch_add(seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST)) {
+        futex_wake(seq);
+    }
+}
+
+// Bytes disponíveis para leitura e espaço livre para escrita. Os índices vêm de
+// memória que o outro processo pode corromper: uma distância acima da capacidade
+// é indicada por SHM_RING_CORRUPT e encerra o canal.
+#define SHM_RING_CORRUPT UINT32_MAX
+
+static uint32_t readable(shm_ring *ring) {
+    uint32_t used = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    return used > SHM_RING_CAPACITY ? SHM_RING_CORRUPT : used;
+}
+
+static uint32_t writable(shm_ring *ring) {
+    uint32_t used = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED) - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    return used > SHM_RING_CAPACITY ? SHM_RING_CORRUPT : SHM_RING_CAPACITY - used;
+}
+
+// Espera até que available() seja positivo: primeiro em espera ativa, depois no futex
+static int wait_for(shm_ring *ring, uint32_t (*available)(shm_ring *), uint32_t *seq, uint32_t *waiting,
+                    shm_keep_waiting keep_waiting, void *context) {
+    for (int i = 0; i < SHM_SPIN_COUNT; i++) {
+        if (available(ring)) {
+            return 0;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    while (1) {
+        uint32_t current = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+
+        if (available(ring)) {
+            __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+            return 0;
+        }
+
+        int result = futex_wait(seq, current, SHM_WAIT_SLICE_MS);
+        int timed_out = result != 0 && errno == ETIMEDOUT;
+        __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+
+        if (available(ring)) {
+            return 0;
+        }
+        if (timed_out && !keep_waiting(context)) {
+            return -1;
+        }
+    }
+}
+
+// Lê exatamente length bytes do anel
+static int read_exact(shm_ring *ring, char *data, size_t length, shm_keep_waiting keep_waiting, void *context) {
+    while (length > 0) {
+        if (wait_for(ring, readable, &ring->data_seq, &ring->reader_waiting, keep_waiting, context) != 0) {
+            return -1;
+        }
+
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        uint32_t count = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - head;
+        if (count > SHM_RING_CAPACITY) {
+            return -1;
+        }
+        if (count > length) {
+            count = length;
+        }
+
+        // Copia em até duas partes quando os dados dão a volta no anel
+        uint32_t offset = head & RING_MASK;
+        uint32_t first = SHM_RING_CAPACITY - offset < count ? SHM_RING_CAPACITY - offset : count;
+        memcpy(data, ring->data + offset, first);
+        memcpy(data + first, ring->data, count - first);
+
+        __atomic_store_n(&ring->head, head + count, __ATOMIC_RELEASE);
+        notify(&ring->space_seq, &ring->writer_waiting);
+
+        data += count;
+        length -= count;
+    }
+    return 0;
+}
+
+// Grava bytes no anel, aguardando o consumidor liberar espaço
+int shm_ring_write(shm_ring *ring, const void *data, size_t length, shm_keep_waiting keep_waiting, void *context) {
+    const char *bytes = data;
+
+    while (length > 0) {
+        if (wait_for(ring, writable, &ring->space_seq, &ring->writer_waiting, keep_waiting, context) != 0) {
+            return -1;
+        }
+
+        uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        uint32_t used = tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (used > SHM_RING_CAPACITY) {
+            return -1;
+        }
+        uint32_t count = SHM_RING_CAPACITY - used;
+        if (count > length) {
+            count = length;
+        }
+
+        uint32_t offset = tail & RING_MASK;
+        uint32_t first = SHM_RING_CAPACITY - offset < count ? SHM_RING_CAPACITY - offset : count;
+        memcpy(ring->data + offset, bytes, first);
+        memcpy(ring->data, bytes + first, count - first);
+
+        __atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+        notify(&ring->data_seq, &ring->reader_waiting);
+
+        bytes += count;
+        length -= count;
+    }
+    return 0;
+}
+
+// Grava o cabeçalho com o tamanho da mensagem
+int shm_ring_begin_message(shm_ring *ring, size_t length, shm_keep_waiting keep_waiting, void *context) {
+    uint32_t header = (uint32_t)length;
+    return shm_ring_write(ring, &header, sizeof(header), keep_waiting, context);
+}
+
+// Recebe uma mensagem inteira; um tamanho acima de max_length é erro de protocolo
+int shm_ring_receive(shm_ring *ring, char **data, size_t *length, size_t max_length, shm_keep_waiting keep_waiting,
+                     void *context) {
+    uint32_t header;
+    if (read_exact(ring, (char *)&header, sizeof(header), keep_waiting, context) != 0) {
+        return -1;
+    }
+    if (header > max_length) {
+        return -1;
+    }
+
+    char *message = malloc((size_t)header + 1);
+    if (!message) {
+        return -1;
+    }
+    if (read_exact(ring, message, header, keep_waiting, context) != 0) {
+        free(message);
+        return -1;
+    }
+
+    message[header] = '\0';
+    *data = message;
+    *length = header;
+    return 0;
+}
+
+// Cria o canal em um memfd, que será enviado ao cliente pelo socket Unix
+shm_channel *shm_channel_create(int *fd) {
+    *fd = memfd_create("movies-shm", MFD_CLOEXEC);
+    if (*fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(*fd, sizeof(shm_channel)) != 0) {
+        close(*fd);
+        return NULL;
+    }
+
+    shm_channel *channel = shm_channel_map(*fd);
+    if (!channel) {
+        close(*fd);
+        return NULL;
+    }
+
+    // A memória de um memfd recém-criado já vem zerada
+    channel->capacity = SHM_RING_CAPACITY;
+    __atomic_store_n(&channel->magic, SHM_CHANNEL_MAGIC, __ATOMIC_RELEASE);
+    return channel;
+}
+
+// Mapeia o canal
+shm_channel *shm_channel_map(int fd) {
+    shm_channel *channel = mmap(NULL, sizeof(shm_channel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return channel == MAP_FAILED ? NULL : channel;
+}
+
+// Desfaz o mapeamento
+void shm_channel_unmap(shm_channel *channel) {
+    munmap(channel, sizeof(shm_channel));
+}
@@ -0,0 +1,65 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Socket Unix usado para negociar o transporte por memória compartilhada
+#define SHM_SOCKET_PATH "/tmp/movies-shm.sock"
+
+// Capacidade de cada sentido do canal (potência de 2)
+#define SHM_RING_CAPACITY (1 << 20)
+
+// Identificação do formato do canal
+#define SHM_CHANNEL_MAGIC 0x4D4F5631
+
+// Intervalo em que uma espera é interrompida para verificar se o outro lado continua ativo
+#define SHM_WAIT_SLICE_MS 100
+
+// Anel de bytes com um produtor e um consumidor, em processos diferentes.
+// As mensagens são gravadas com um cabeçalho de 4 bytes com o tamanho.
+typedef struct {
+    uint32_t head;
+    uint32_t reader_waiting;
+    uint32_t data_seq;
+    char pad1[52];
+    uint32_t tail;
+    uint32_t writer_waiting;
+    uint32_t space_seq;
+    char pad2[52];
+    char data[SHM_RING_CAPACITY];
+} shm_ring;
+
+// Canal completo: requisições do cliente e respostas do servidor
+typedef struct {
+    uint32_t magic;
+    uint32_t capacity;
+    char pad[56];
+    shm_ring request;
+    shm_ring response;
+} shm_channel;
+
+// Chamado quando uma espera excede SHM_WAIT_SLICE_MS; retorna 0 para desistir
+typedef int (*shm_keep_waiting)(void *context);
+
+// Cria um canal em memória anônima (memfd) e retorna seu descritor em fd
+shm_channel *shm_channel_create(int *fd);
+
+// Mapeia um canal recebido de outro processo
+shm_channel *shm_channel_map(int fd);
+
+// Desfaz o mapeamento
+void shm_channel_unmap(shm_channel *channel);
+
+// Inicia uma mensagem de length bytes; o conteúdo segue em uma ou mais chamadas a shm_ring_write
+int shm_ring_begin_message(shm_ring *ring, size_t length, shm_keep_waiting keep_waiting, void *context);
+
+// Grava bytes no anel, aguardando espaço quando necessário; retorna -1 se a espera for abandonada
+int shm_ring_write(shm_ring *ring, const void *data, size_t length, shm_keep_waiting keep_waiting, void *context);
+
+// Recebe uma mensagem inteira em memória alocada (terminada em '\0'); retorna -1 se a
+// espera for abandonada, se a mensagem exceder max_length ou se o anel estiver corrompido
+int shm_ring_receive(shm_ring *ring, char **data, size_t *length, size_t max_length, shm_keep_waiting keep_waiting,
+                     void *context);
+
+#endif
@@ -0,0 +1,240 @@
+#include "shm_transport.h"
+#include "shm_ring.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+// Socket de negociação e parâmetros compartilhados pelas sessões
+static int listen_fd = -1;
+static struct stat listen_file;
+static int shutdown_fd = -1;
+static input_handler handler;
+static int stopping = 0;
+
+// Estado de uma sessão por memória compartilhada
+typedef struct {
+    connection conn;
+    shm_channel *channel;
+} shm_session;
+
+// Verifica se o cliente continua conectado e, se watch_shutdown, se o servidor não está encerrando
+static int session_check(shm_session *session, int watch_shutdown) {
+    struct pollfd fds[2] = {
+        {.fd = session->conn.fd, .events = POLLIN, .revents = 0},
+        {.fd = shutdown_fd, .events = POLLIN, .revents = 0},
+    };
+
+    if (poll(fds, watch_shutdown ? 2 : 1, 0) < 0) {
+        return errno == EINTR;
+    }
+    if (watch_shutdown && (fds[1].revents & POLLIN)) {
+        return 0;
+    }
+    if (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        return 0;
+    }
+    if (fds[0].revents & POLLIN) {
+        // O cliente não envia nada pelo socket; dados legíveis aqui significam fim de arquivo
+        char byte;
+        return recv(session->conn.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) > 0;
+    }
+    return 1;
+}
+
+// Interrompe a espera por requisições quando o cliente some, fica ocioso demais ou o servidor encerra
+static int session_alive(void *context) {
+    return session_check(context, 1);
+}
+
+// Interrompe o envio de respostas só quando o cliente some ou fica ocioso demais: no
+// encerramento, as respostas já produzidas ainda são entregues (até SHUTDOWN_DRAIN_MS)
+static int session_connected(void *context) {
+    return session_check(context, 0);
+}
+
+// Envia ao cliente o descritor do memfd com o canal
+static int send_channel(int fd, int memfd) {
+    char payload = 'S';
+    struct iovec iov = {.iov_base = &payload, .iov_len = 1};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr message;
+
+    memset(&message, 0, sizeof(message));
+    memset(&control, 0, sizeof(control));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+
+    return sendmsg(fd, &message, MSG_NOSIGNAL) == 1 ? 0 : -1;
+}
+
+// Copia a fila de saída da conexão para o anel de respostas como uma única mensagem
+static int send_response(shm_session *session) {
+    output_queue *out = &session->conn.out;
+    shm_ring *ring = &session->channel->response;
+
+    if (shm_ring_begin_message(ring, out->pending, session_connected, session) != 0) {
+        return -1;
+    }
+
+    while (out->pending > 0) {
+        struct iovec iov;
+        output_queue_iov(out, &iov, 1);
+        if (shm_ring_write(ring, iov.iov_base, iov.iov_len, session_connected, session) != 0) {
+            return -1;
+        }
+        output_queue_consume(out, iov.iov_len);
+    }
+    return 0;
+}
+
+// Atende um cliente: cada mensagem do anel de requisições recebe uma mensagem de resposta
+static void *serve_session(void *arg) {
+    int fd = *((int *)arg);
+    free(arg);
+
+    shm_session session;
+    int memfd;
+
+    session.channel = shm_channel_create(&memfd);
+    if (!session.channel) {
+        perror("Falha ao criar canal de memória compartilhada");
+        close(fd);
+        connection_slot_release();
+        return NULL;
+    }
+
+    int sent = send_channel(fd, memfd);
+    close(memfd);
+    connection_init(&session.conn, fd);
+
+    // No encerramento, novas requisições deixam de ser lidas; a última resposta já foi enviada
+    while (sent == 0 && !__atomic_load_n(&stopping, __ATOMIC_RELAXED)) {
+        char *request;
+        size_t length;
+
+        // Requisições grandes demais ou um anel corrompido encerram a sessão
+        if (shm_ring_receive(&session.channel->request, &request, &length, SHM_REQUEST_MAX, session_alive,
+                             &session) != 0) {
+            break;
+        }
+
+        connection_touch(&session.conn);
+        int closing = handler(&session.conn, request);
+        free(request);
+
+        if (closing && session.conn.out.pending == 0) {
+            break;
+        }
+        TRACE_BEGIN(send);
+        size_t pending = session.conn.out.pending;
+        if (send_response(&session) != 0 || closing) {
+            break;
+        }
+        TRACE_END_BYTES(send, "send", pending);
+        connection_touch(&session.conn);
+    }
+
+    int timed_out = connection_timed_out(&session.conn);
+    connection_close(&session.conn);
+    shm_channel_unmap(session.channel);
+    connection_slot_release();
+    printf(timed_out ? "Cliente desconectado por inatividade\n" : "Cliente desconectado\n");
+    return NULL;
+}
+
+// Aceita clientes no socket de negociação até o encerramento do servidor
+static void *accept_sessions(void *arg) {
+    (void)arg;
+
+    while (1) {
+        struct pollfd fds[2] = {
+            {.fd = listen_fd, .events = POLLIN, .revents = 0},
+            {.fd = shutdown_fd, .events = POLLIN, .revents = 0},
+        };
+
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+
+        int client_socket = accept(listen_fd, NULL, NULL);
+        if (client_socket < 0) {
+            continue;
+        }
+
+        // Recusa o cliente de forma educada se o limite de conexões foi atingido
+        if (connection_slot_acquire() != 0) {
+            const char *busy = "Erro: servidor lotado, tente novamente mais tarde";
+            send(client_socket, busy, strlen(busy) + 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+            close(client_socket);
+            continue;
+        }
+
+        pthread_t thread_id;
+        int *pclient = malloc(sizeof(int));
+        *pclient = client_socket;
+
+        if (pthread_create(&thread_id, NULL, serve_session, pclient) != 0) {
+            perror("Falha ao criar thread");
+            close(client_socket);
+            free(pclient);
+            connection_slot_release();
+        } else {
+            pthread_detach(thread_id);
+        }
+    }
+    return NULL;
+}
+
+// Cria o socket de negociação e inicia a thread que aceita as sessões
+int shm_transport_start(int shutdown, input_handler process_input) {
+    pthread_t thread_id;
+
+    listen_fd = unix_listen(SHM_SOCKET_PATH, &listen_file);
+    if (listen_fd < 0) {
+        return -1;
+    }
+
+    shutdown_fd = shutdown;
+    handler = process_input;
+
+    if (pthread_create(&thread_id, NULL, accept_sessions, NULL) != 0) {
+        close(listen_fd);
+        unix_unlink(SHM_SOCKET_PATH, &listen_file);
+        listen_fd = -1;
+        return -1;
+    }
+    pthread_detach(thread_id);
+    return 0;
+}
+
+// Remove o socket de negociação; as sessões deixam de ler novas requisições
+void shm_transport_stop() {
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELAXED);
+    if (listen_fd >= 0) {
+        unix_unlink(SHM_SOCKET_PATH, &listen_file);
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include "connection.h"
+
+// Tamanho máximo de uma requisição, o mesmo aceito pelos sockets (BUFFER_SIZE)
+#define SHM_REQUEST_MAX 4096
+
+// Inicia o transporte por memória compartilhada para clientes na mesma máquina.
+// Cada cliente se conecta ao socket Unix SHM_SOCKET_PATH e recebe um memfd com
+// dois anéis (requisições e respostas); o socket continua aberto apenas para
+// detectar o fim da sessão. Retorna -1 se o socket não puder ser criado.
+int shm_transport_start(int shutdown_fd, input_handler handler);
+
+// Remove o arquivo do socket de negociação e para de ler novas requisições das sessões
+void shm_transport_stop();
+
+#endif
@@ -0,0 +1,488 @@
+#include "text_match.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXT_MATCH_X86 1
+#endif
+
+// Espaço extra ao final dos buffers para que os kernels leiam blocos inteiros
+#define TEXT_PADDING 32
+
+// Dobra "frouxa", independente do byte anterior: A-Z e os bytes de continuação
+// 0x80-0x9E (exceto 0x97, o sinal ×) recebem +0x20. Textos iguais pela dobra exata
+// são sempre iguais pela frouxa, então ela serve de filtro rápido para os kernels.
+static inline unsigned char loose_fold(unsigned char c) {
+    if ((unsigned char)(c - 'A') < 26) {
+        return c + 0x20;
+    }
+    if ((unsigned char)(c - 0x80) < 0x1F && c != 0x97) {
+        return c + 0x20;
+    }
+    return c;
+}
+
+// Dobra exata: ASCII e, em UTF-8, os caracteres U+00C0-U+00DE (0xC3 0x80-0x9E)
+static inline unsigned char exact_fold(unsigned char c, unsigned char previous) {
+    if ((unsigned char)(c - 'A') < 26) {
+        return c + 0x20;
+    }
+    if (previous == 0xC3 && (unsigned char)(c - 0x80) < 0x1F && c != 0x97) {
+        return c + 0x20;
+    }
+    return c;
+}
+
+// Compara com a dobra exata o texto a partir de value com o padrão já dobrado
+static int verify_exact(const char *value, size_t position, const text_pattern *pattern) {
+    const unsigned char *text = (const unsigned char *)value + position;
+    const unsigned char *folded = (const unsigned char *)pattern->folded;
+    unsigned char previous = position > 0 ? text[-1] : 0;
+
+    for (size_t i = 0; i < pattern->length; i++) {
+        if (exact_fold(text[i], previous) != folded[i]) {
+            return 0;
+        }
+        previous = text[i];
+    }
+    return 1;
+}
+
+// Compara com a dobra frouxa
+static int verify_loose(const char *value, size_t from, size_t to, const text_pattern *pattern) {
+    for (size_t i = from; i < to; i++) {
+        if (loose_fold((unsigned char)value[i]) != (unsigned char)pattern->loose[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Kernels escalares
+
+static int equals_scalar(const char *value, size_t length, const text_pattern *pattern, int padded) {
+    (void)padded;
+    if (length != pattern->length) {
+        return 0;
+    }
+    return verify_exact(value, 0, pattern);
+}
+
+static int contains_scalar(const char *value, size_t length, const text_pattern *pattern, int padded) {
+    (void)padded;
+    if (pattern->length == 0) {
+        return 1;
+    }
+    if (length < pattern->length) {
+        return 0;
+    }
+
+    unsigned char first = pattern->loose[0];
+    for (size_t i = 0; i + pattern->length <= length; i++) {
+        if (loose_fold((unsigned char)value[i]) == first && verify_exact(value, i, pattern)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#ifdef TEXT_MATCH_X86
+
+// ---------------------------------------------------------------------------
+// Kernels SSE2 (16 bytes por iteração)
+
+__attribute__((target("sse2")))
+static inline __m128i loose_fold_sse2(__m128i x) {
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+
+    // Comparações sem sinal feitas como comparações com sinal após deslocar por 0x80
+    __m128i upper = _mm_cmplt_epi8(_mm_xor_si128(_mm_sub_epi8(x, _mm_set1_epi8('A')), bias),
+                                   _mm_set1_epi8((char)(26 ^ 0x80)));
+    __m128i latin = _mm_cmplt_epi8(_mm_xor_si128(_mm_sub_epi8(x, bias), bias),
+                                   _mm_set1_epi8((char)(0x1F ^ 0x80)));
+    latin = _mm_andnot_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8((char)0x97)), latin);
+
+    __m128i mask = _mm_or_si128(upper, latin);
+    return _mm_add_epi8(x, _mm_and_si128(mask, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("sse2")))
+static int equals_sse2(const char *value, size_t length, const text_pattern *pattern, int padded) {
+    if (length != pattern->length) {
+        return 0;
+    }
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = loose_fold_sse2(_mm_loadu_si128((const __m128i *)(value + i)));
+        __m128i p = _mm_loadu_si128((const __m128i *)(pattern->loose + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, p)) != 0xFFFF) {
+            return 0;
+        }
+    }
+
+    if (i < length) {
+        if (padded) {
+            // O buffer tem folga: compara o bloco inteiro e ignora os bytes além do fim
+            unsigned int valid = (1u << (length - i)) - 1;
+            __m128i v = loose_fold_sse2(_mm_loadu_si128((const __m128i *)(value + i)));
+            __m128i p = _mm_loadu_si128((const __m128i *)(pattern->loose + i));
+            if (((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, p)) & valid) != valid) {
+                return 0;
+            }
+        } else if (!verify_loose(value, i, length, pattern)) {
+            return 0;
+        }
+    }
+
+    // Padrões só com ASCII não precisam da verificação exata
+    return pattern->ascii || verify_exact(value, 0, pattern);
+}
+
+__attribute__((target("sse2")))
+static int contains_sse2(const char *value, size_t length, const text_pattern *pattern, int padded) {
+    size_t n = pattern->length;
+    if (n == 0) {
+        return 1;
+    }
+    if (length < n) {
+        return 0;
+    }
+
+    // Filtra candidatos comparando o primeiro e o último byte do padrão em 16 posições de uma vez
+    const __m128i first = _mm_set1_epi8(pattern->loose[0]);
+    const __m128i last = _mm_set1_epi8(pattern->loose[n - 1]);
+    size_t candidates = length - n + 1;
+    size_t i = 0;
+
+    for (; i < candidates; i += 16) {
+        if (!padded && i + n - 1 + 16 > length) {
+            break;
+        }
+
+        __m128i block_first = loose_fold_sse2(_mm_loadu_si128((const __m128i *)(value + i)));
+        __m128i block_last = loose_fold_sse2(_mm_loadu_si128((const __m128i *)(value + i + n - 1)));
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                            _mm_cmpeq_epi8(block_last, last)));
+        if (candidates - i < 16) {
+            mask &= (1u << (candidates - i)) - 1;
+        }
+
+        while (mask) {
+            size_t position = i + __builtin_ctz(mask);
+            if (verify_exact(value, position, pattern)) {
+                return 1;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i < candidates; i++) {
+        if (verify_exact(value, i, pattern)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Kernels AVX2 (32 bytes por iteração)
+
+__attribute__((target("avx2")))
+static inline __m256i loose_fold_avx2(__m256i x) {
+    const __m256i bias = _mm256_set1_epi8((char)0x80);
+
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(26 ^ 0x80)),
+                                      _mm256_xor_si256(_mm256_sub_epi8(x, _mm256_set1_epi8('A')), bias));
+    __m256i latin = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x1F ^ 0x80)),
+                                      _mm256_xor_si256(_mm256_sub_epi8(x, bias), bias));
+    latin = _mm256_andnot_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8((char)0x97)), latin);
+
+    __m256i mask = _mm256_or_si256(upper, latin);
+    return _mm256_add_epi8(x, _mm256_and_si256(mask, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static int equals_avx2(const char *value, size_t length, const text_pattern *pattern, int padded) {
+    if (length != pattern->length) {
+        return 0;
+    }
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i v = loose_fold_avx2(_mm256_loadu_si256((const __m256i *)(value + i)));
+        __m256i p = _mm256_loadu_si256((const __m256i *)(pattern->loose + i));
+        if ((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, p)) != 0xFFFFFFFFu) {
+            return 0;
+        }
+    }
+
+    if (i < length) {
+        if (padded) {
+            uint32_t valid = (uint32_t)((1ULL << (length - i)) - 1);
+            __m256i v = loose_fold_avx2(_mm256_loadu_si256((const __m256i *)(value + i)));
+            __m256i p = _mm256_loadu_si256((const __m256i *)(pattern->loose + i));
+            if (((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, p)) & valid) != valid) {
+                return 0;
+            }
+        } else if (!verify_loose(value, i, length, pattern)) {
+            return 0;
+        }
+    }
+
+    return pattern->ascii || verify_exact(value, 0, pattern);
+}
+
+__attribute__((target("avx2")))
+static int contains_avx2(const char *value, size_t length, const text_pattern *pattern, int padded) {
+    size_t n = pattern->length;
+    if (n == 0) {
+        return 1;
+    }
+    if (length < n) {
+        return 0;
+    }
+
+    const __m256i first = _mm256_set1_epi8(pattern->loose[0]);
+    const __m256i last = _mm256_set1_epi8(pattern->loose[n - 1]);
+    size_t candidates = length - n + 1;
+    size_t i = 0;
+
+    for (; i < candidates; i += 32) {
+        if (!padded && i + n - 1 + 32 > length) {
+            break;
+        }
+
+        __m256i block_first = loose_fold_avx2(_mm256_loadu_si256((const __m256i *)(value + i)));
+        __m256i block_last = loose_fold_avx2(_mm256_loadu_si256((const __m256i *)(value + i + n - 1)));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                                              _mm256_cmpeq_epi8(block_last, last)));
+        if (candidates - i < 32) {
+            mask &= (uint32_t)((1ULL << (candidates - i)) - 1);
+        }
+
+        while (mask) {
+            size_t position = i + __builtin_ctz(mask);
+            if (verify_exact(value, position, pattern)) {
+                return 1;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i < candidates; i++) {
+        if (verify_exact(value, i, pattern)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Seleção da implementação em tempo de execução
+
+typedef int (*match_kernel)(const char *value, size_t length, const text_pattern *pattern, int padded);
+
+static const char *kernel_name = "scalar";
+static match_kernel equals_kernel = equals_scalar;
+static match_kernel contains_kernel = contains_scalar;
+
+// Escolhe a melhor implementação suportada pelo processador
+__attribute__((constructor))
+static void select_best_kernels() {
+#ifdef TEXT_MATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        text_match_select("avx2");
+    } else if (__builtin_cpu_supports("sse2")) {
+        text_match_select("sse2");
+    }
+#endif
+}
+
+// Força uma implementação específica
+int text_match_select(const char *name) {
+    if (strcmp(name, "scalar") == 0) {
+        kernel_name = "scalar";
+        equals_kernel = equals_scalar;
+        contains_kernel = contains_scalar;
+        return 0;
+    }
+#ifdef TEXT_MATCH_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        kernel_name = "sse2";
+        equals_kernel = equals_sse2;
+        contains_kernel = contains_sse2;
+        return 0;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        kernel_name = "avx2";
+        equals_kernel = equals_avx2;
+        contains_kernel = contains_avx2;
+        return 0;
+    }
+#endif
+    return -1;
+}
+
+// Nome da implementação em uso
+const char *text_match_implementation() {
+    return kernel_name;
+}
+
+// ---------------------------------------------------------------------------
+// Padrões e colunas
+
+// Calcula as duas dobras do texto procurado
+int text_pattern_init(text_pattern *pattern, const char *text) {
+    size_t length = strlen(text);
+
+    pattern->folded = calloc(length + TEXT_PADDING, 1);
+    pattern->loose = calloc(length + TEXT_PADDING, 1);
+    if (!pattern->folded || !pattern->loose) {
+        text_pattern_free(pattern);
+        return -1;
+    }
+
+    pattern->length = length;
+    pattern->ascii = 1;
+
+    unsigned char previous = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = text[i];
+        pattern->folded[i] = exact_fold(c, previous);
+        pattern->loose[i] = loose_fold(c);
+        if (c >= 0x80) {
+            pattern->ascii = 0;
+        }
+        previous = c;
+    }
+    return 0;
+}
+
+// Libera os buffers do padrão
+void text_pattern_free(text_pattern *pattern) {
+    free(pattern->folded);
+    free(pattern->loose);
+    pattern->folded = NULL;
+    pattern->loose = NULL;
+}
+
+// Aplica a dobra exata a um texto; o resultado tem o mesmo tamanho
+void text_fold(const char *text, size_t length, char *out) {
+    unsigned char previous = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = text[i];
+        out[i] = exact_fold(c, previous);
+        previous = c;
+    }
+}
+
+// Inicializa uma coluna vazia
+void text_column_init(text_column *column) {
+    memset(column, 0, sizeof(*column));
+}
+
+// Acrescenta um valor à coluna, mantendo folga após o último byte
+int text_column_add(text_column *column, const char *value, int row) {
+    size_t length = strlen(value);
+
+    if (column->count == column->capacity) {
+        size_t capacity = column->capacity ? column->capacity * 2 : 64;
+        size_t *offsets = realloc(column->offsets, capacity * sizeof(size_t));
+        if (!offsets) {
+            return -1;
+        }
+        column->offsets = offsets;
+
+        size_t *lengths = realloc(column->lengths, capacity * sizeof(size_t));
+        if (!lengths) {
+            return -1;
+        }
+        column->lengths = lengths;
+
+        int *rows = realloc(column->rows, capacity * sizeof(int));
+        if (!rows) {
+            return -1;
+        }
+        column->rows = rows;
+        column->capacity = capacity;
+    }
+
+    if (column->data_length + length + 1 + TEXT_PADDING > column->data_capacity) {
+        size_t capacity = column->data_capacity ? column->data_capacity * 2 : 4096;
+        while (capacity < column->data_length + length + 1 + TEXT_PADDING) {
+            capacity *= 2;
+        }
+        char *data = realloc(column->data, capacity);
+        if (!data) {
+            return -1;
+        }
+        column->data = data;
+        column->data_capacity = capacity;
+    }
+
+    memcpy(column->data + column->data_length, value, length + 1);
+    memset(column->data + column->data_length + length + 1, 0, TEXT_PADDING);
+
+    column->offsets[column->count] = column->data_length;
+    column->lengths[column->count] = length;
+    column->rows[column->count] = row;
+    column->count++;
+    column->data_length += length + 1;
+    return 0;
+}
+
+// Libera os buffers da coluna
+void text_column_free(text_column *column) {
+    free(column->data);
+    free(column->offsets);
+    free(column->lengths);
+    free(column->rows);
+    text_column_init(column);
+}
+
+// Igualdade sem diferenciar maiúsculas de minúsculas
+int text_equals_ci(const char *value, size_t length, const text_pattern *pattern) {
+    return equals_kernel(value, length, pattern, 0);
+}
+
+// Busca de substring sem diferenciar maiúsculas de minúsculas
+int text_contains_ci(const char *value, size_t length, const text_pattern *pattern) {
+    return contains_kernel(value, length, pattern, 0);
+}
+
+// Aplica um kernel a todos os valores da coluna
+static size_t match_column(const text_column *column, const text_pattern *pattern,
+                           unsigned char *row_matches, match_kernel kernel) {
+    size_t matched = 0;
+
+    for (size_t i = 0; i < column->count; i++) {
+        int row = column->rows[i];
+        if (row_matches[row]) {
+            continue;
+        }
+        if (kernel(column->data + column->offsets[i], column->lengths[i], pattern, 1)) {
+            row_matches[row] = 1;
+            matched++;
+        }
+    }
+    return matched;
+}
+
+// Marca as linhas com algum valor igual ao padrão
+size_t text_column_match_equals(const text_column *column, const text_pattern *pattern, unsigned char *row_matches) {
+    return match_column(column, pattern, row_matches, equals_kernel);
+}
+
+// Marca as linhas com algum valor que contenha o padrão
+size_t text_column_match_contains(const text_column *column, const text_pattern *pattern, unsigned char *row_matches) {
+    return match_column(column, pattern, row_matches, contains_kernel);
+}
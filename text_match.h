@@ -0,0 +1,58 @@
+#ifndef TEXT_MATCH_H
+#define TEXT_MATCH_H
+
+#include <stddef.h>
+
+// Comparação de textos sem diferenciar maiúsculas de minúsculas. A dobra de caixa
+// cobre ASCII e as letras acentuadas do Latin-1 em UTF-8 (À-Þ), suficiente para
+// títulos e gêneros em português. Os kernels usam AVX2 ou SSE2 quando disponíveis,
+// escolhidos em tempo de execução, com versão escalar como alternativa.
+
+// Texto procurado, com a dobra de caixa calculada uma única vez
+typedef struct {
+    char *folded;
+    char *loose;
+    size_t length;
+    int ascii;
+} text_pattern;
+
+// Coluna de textos armazenados de forma contígua; cada valor pertence a uma linha
+typedef struct {
+    char *data;
+    size_t data_length;
+    size_t data_capacity;
+    size_t *offsets;
+    size_t *lengths;
+    int *rows;
+    size_t count;
+    size_t capacity;
+} text_column;
+
+// Prepara e libera um padrão de busca
+int text_pattern_init(text_pattern *pattern, const char *text);
+void text_pattern_free(text_pattern *pattern);
+
+// Funções de construção da coluna
+void text_column_init(text_column *column);
+int text_column_add(text_column *column, const char *value, int row);
+void text_column_free(text_column *column);
+
+// Grava em out (com length bytes) o texto com a dobra de caixa exata
+void text_fold(const char *text, size_t length, char *out);
+
+// Kernels para um único valor
+int text_equals_ci(const char *value, size_t length, const text_pattern *pattern);
+int text_contains_ci(const char *value, size_t length, const text_pattern *pattern);
+
+// Marca em row_matches as linhas com algum valor igual ao (ou contendo o) padrão;
+// retorna o número de linhas marcadas
+size_t text_column_match_equals(const text_column *column, const text_pattern *pattern, unsigned char *row_matches);
+size_t text_column_match_contains(const text_column *column, const text_pattern *pattern, unsigned char *row_matches);
+
+// Nome da implementação escolhida ("avx2", "sse2" ou "scalar")
+const char *text_match_implementation();
+
+// Força uma implementação específica (usado pelo benchmark); retorna -1 se não suportada
+int text_match_select(const char *name);
+
+#endif
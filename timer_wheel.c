@@ -0,0 +1,122 @@
+#include "timer_wheel.h"
+
+#include <stddef.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+// Insere o temporizador no final da lista de uma posição
+static void link_entry(timer_entry *head, timer_entry *entry) {
+    entry->prev = head->prev;
+    entry->next = head;
+    head->prev->next = entry;
+    head->prev = entry;
+}
+
+// Escolhe o nível e a posição de acordo com a distância até o vencimento
+static void place_entry(timer_wheel *wheel, timer_entry *entry) {
+    uint64_t expires = entry->expires;
+    if (expires <= wheel->now) {
+        expires = wheel->now + 1;
+    }
+
+    uint64_t delta = expires - wheel->now;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    // Vencimentos além do último nível ficam na posição mais distante e são reavaliados na cascata
+    uint64_t max_delta = 1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+    if (delta >= max_delta) {
+        expires = wheel->now + max_delta - 1;
+    }
+
+    int slot = (expires >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK;
+    link_entry(&wheel->slots[level][slot], entry);
+}
+
+// Redistribui os temporizadores de uma posição de nível superior
+static void cascade(timer_wheel *wheel, int level, int slot) {
+    timer_entry *head = &wheel->slots[level][slot];
+    timer_entry *entry = head->next;
+
+    head->next = head;
+    head->prev = head;
+
+    while (entry != head) {
+        timer_entry *next = entry->next;
+        place_entry(wheel, entry);
+        entry = next;
+    }
+}
+
+// Inicializa todas as posições como listas vazias
+void timer_wheel_init(timer_wheel *wheel, uint64_t now) {
+    wheel->now = now;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            timer_entry *head = &wheel->slots[level][slot];
+            head->next = head;
+            head->prev = head;
+        }
+    }
+}
+
+// Prepara um temporizador ainda não agendado
+void timer_entry_init(timer_entry *entry, void (*callback)(timer_entry *entry, void *context)) {
+    entry->next = NULL;
+    entry->prev = NULL;
+    entry->expires = 0;
+    entry->callback = callback;
+}
+
+// Agenda (ou reagenda) um temporizador
+void timer_wheel_schedule(timer_wheel *wheel, timer_entry *entry, uint64_t expires) {
+    timer_wheel_cancel(entry);
+    entry->expires = expires;
+    place_entry(wheel, entry);
+}
+
+// Remove o temporizador da lista em que estiver
+void timer_wheel_cancel(timer_entry *entry) {
+    if (!entry->next) {
+        return;
+    }
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->next = NULL;
+    entry->prev = NULL;
+}
+
+// Indica se o temporizador está em alguma posição da roda
+int timer_entry_pending(const timer_entry *entry) {
+    return entry->next != NULL;
+}
+
+// Processa tick a tick até alcançar o instante informado
+void timer_wheel_advance(timer_wheel *wheel, uint64_t now, void *context) {
+    while (wheel->now < now) {
+        wheel->now++;
+
+        // Ao completar uma volta em um nível, desce os temporizadores do nível seguinte
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if ((wheel->now & ((1ULL << (TIMER_WHEEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(wheel, level, (wheel->now >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK);
+        }
+
+        timer_entry *head = &wheel->slots[0][wheel->now & SLOT_MASK];
+        while (head->next != head) {
+            timer_entry *entry = head->next;
+            timer_wheel_cancel(entry);
+
+            // Temporizadores limitados ao alcance máximo da roda voltam a ser agendados
+            if (entry->expires > wheel->now) {
+                place_entry(wheel, entry);
+                continue;
+            }
+            entry->callback(entry, context);
+        }
+    }
+}
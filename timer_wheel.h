@@ -0,0 +1,43 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+// Cada nível possui 64 posições; cada posição de um nível cobre 64 posições do nível anterior
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+// Temporizador intrusivo, embutido na estrutura de quem o utiliza
+typedef struct timer_entry {
+    struct timer_entry *next;
+    struct timer_entry *prev;
+    uint64_t expires;
+    void (*callback)(struct timer_entry *entry, void *context);
+} timer_entry;
+
+// Roda de temporização hierárquica com resolução de um tick
+typedef struct {
+    uint64_t now;
+    timer_entry slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} timer_wheel;
+
+// Inicializa a roda a partir do tick atual
+void timer_wheel_init(timer_wheel *wheel, uint64_t now);
+
+// Prepara um temporizador para uso
+void timer_entry_init(timer_entry *entry, void (*callback)(timer_entry *entry, void *context));
+
+// Agenda um temporizador para o tick informado (reagenda se já estiver ativo)
+void timer_wheel_schedule(timer_wheel *wheel, timer_entry *entry, uint64_t expires);
+
+// Cancela um temporizador; não faz nada se ele não estiver agendado
+void timer_wheel_cancel(timer_entry *entry);
+
+// Indica se o temporizador está agendado
+int timer_entry_pending(const timer_entry *entry);
+
+// Avança a roda até o tick informado, disparando os temporizadores vencidos
+void timer_wheel_advance(timer_wheel *wheel, uint64_t now, void *context);
+
+#endif
@@ -0,0 +1,298 @@
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Etapa registrada; async indica uma etapa que prosseguiu fora da thread
+typedef struct {
+    const char *name;
+    uint64_t start;
+    uint64_t duration;
+    uint64_t request;
+    int64_t bytes;
+    int tid;
+    int async;
+} trace_event;
+
+// Anel de eventos de uma thread. Só a thread dona escreve: ela grava o evento na
+// posição head e depois avança head. Quem exporta lê sem bloquear e descarta os
+// eventos que podem ter sido sobrescritos durante a cópia, como em um seqlock.
+// Os anéis nunca são liberados; o de uma thread encerrada é reaproveitado pela
+// próxima, e seus eventos continuam disponíveis até serem sobrescritos.
+typedef struct trace_ring {
+    struct trace_ring *next;
+    int owned;
+    uint64_t head;
+    trace_event events[TRACE_RING_EVENTS];
+} trace_ring;
+
+static trace_ring *rings = NULL;
+static uint64_t last_request = 0;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static __thread trace_ring *thread_ring = NULL;
+static __thread uint64_t thread_request = 0;
+static __thread int thread_tid = 0;
+static int signal_pipe[2] = {-1, -1};
+
+// Relógio monotônico em nanossegundos
+uint64_t trace_clock_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Devolve o anel quando a thread termina
+static void release_ring(void *ring) {
+    __atomic_store_n(&((trace_ring *)ring)->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void create_ring_key() {
+    pthread_key_create(&ring_key, release_ring);
+}
+
+// Obtém o anel da thread atual, reaproveitando o de uma thread encerrada
+static trace_ring *claim_ring() {
+    pthread_once(&ring_key_once, create_ring_key);
+
+    trace_ring *ring;
+    for (ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&ring->owned, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (!ring) {
+        ring = calloc(1, sizeof(trace_ring));
+        if (!ring) {
+            return NULL;
+        }
+        ring->owned = 1;
+        ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    pthread_setspecific(ring_key, ring);
+    thread_tid = (int)syscall(SYS_gettid);
+    thread_ring = ring;
+    return ring;
+}
+
+// Grava um evento no anel da thread atual
+static void record(const char *name, uint64_t start, int64_t bytes, int async) {
+    trace_ring *ring = thread_ring ? thread_ring : claim_ring();
+    if (!ring) {
+        return;
+    }
+
+    uint64_t now = trace_clock_ns();
+    uint64_t head = ring->head;
+    trace_event *event = &ring->events[head % TRACE_RING_EVENTS];
+
+    // A barreira mantém a publicação do evento anterior antes da sobrescrita da posição
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&event->name, name, __ATOMIC_RELAXED);
+    __atomic_store_n(&event->start, start, __ATOMIC_RELAXED);
+    __atomic_store_n(&event->duration, now - start, __ATOMIC_RELAXED);
+    __atomic_store_n(&event->request, thread_request, __ATOMIC_RELAXED);
+    __atomic_store_n(&event->bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&event->tid, thread_tid, __ATOMIC_RELAXED);
+    __atomic_store_n(&event->async, async, __ATOMIC_RELAXED);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void trace_record(const char *name, uint64_t start, int64_t bytes) {
+    record(name, start, bytes, 0);
+}
+
+void trace_record_async(const char *name, uint64_t start, int64_t bytes) {
+    record(name, start, bytes, 1);
+}
+
+// Numera a requisição que começa na thread atual
+uint64_t trace_request_begin() {
+    thread_request = __atomic_add_fetch(&last_request, 1, __ATOMIC_RELAXED);
+    return trace_clock_ns();
+}
+
+// Registra a requisição inteira; as etapas seguintes não pertencem mais a ela
+void trace_request_end(uint64_t start) {
+    record("request", start, -1, 0);
+    thread_request = 0;
+}
+
+// Copia um evento com as mesmas leituras atômicas usadas na escrita
+static void load_event(const trace_event *event, trace_event *copy) {
+    copy->name = __atomic_load_n(&event->name, __ATOMIC_RELAXED);
+    copy->start = __atomic_load_n(&event->start, __ATOMIC_RELAXED);
+    copy->duration = __atomic_load_n(&event->duration, __ATOMIC_RELAXED);
+    copy->request = __atomic_load_n(&event->request, __ATOMIC_RELAXED);
+    copy->bytes = __atomic_load_n(&event->bytes, __ATOMIC_RELAXED);
+    copy->tid = __atomic_load_n(&event->tid, __ATOMIC_RELAXED);
+    copy->async = __atomic_load_n(&event->async, __ATOMIC_RELAXED);
+}
+
+// Escreve os argumentos de um evento
+static void write_args(FILE *out, const trace_event *event) {
+    fprintf(out, ",\"args\":{");
+    if (event->request) {
+        fprintf(out, "\"request\":%llu%s", (unsigned long long)event->request, event->bytes >= 0 ? "," : "");
+    }
+    if (event->bytes >= 0) {
+        fprintf(out, "\"bytes\":%lld", (long long)event->bytes);
+    }
+    fprintf(out, "}}");
+}
+
+// Escreve um evento; etapas assíncronas viram um par de início e fim com identificador próprio
+static void write_event(FILE *out, const trace_event *event, int pid, uint64_t *async_id, int *first) {
+    fprintf(out, "%s\n", *first ? "" : ",");
+    *first = 0;
+
+    if (!event->async) {
+        fprintf(out, "{\"name\":\"%s\",\"cat\":\"server\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+                event->name, event->start / 1000.0, event->duration / 1000.0, pid, event->tid);
+        write_args(out, event);
+        return;
+    }
+
+    uint64_t id = ++*async_id;
+    fprintf(out, "{\"name\":\"%s\",\"cat\":\"server\",\"ph\":\"b\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+            event->name, (unsigned long long)id, event->start / 1000.0, pid, event->tid);
+    write_args(out, event);
+    fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"server\",\"ph\":\"e\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+            event->name, (unsigned long long)id, (event->start + event->duration) / 1000.0, pid, event->tid);
+}
+
+// Escreve os eventos de todos os anéis, sem interromper as threads que registram
+static int write_trace(FILE *out) {
+    trace_event *copy = malloc(TRACE_RING_EVENTS * sizeof(trace_event));
+    if (!copy) {
+        return -1;
+    }
+
+    int pid = (int)getpid();
+    uint64_t async_id = 0;
+    int first = 1;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (trace_ring *ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t begin = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        for (uint64_t i = begin; i < head; i++) {
+            load_event(&ring->events[i % TRACE_RING_EVENTS], &copy[i - begin]);
+        }
+
+        // A posição de índice head pode estar sendo escrita agora, sobrescrevendo a
+        // de índice head - TRACE_RING_EVENTS: só valem os eventos posteriores a ela
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint64_t now = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        uint64_t valid = now + 1 > TRACE_RING_EVENTS ? now + 1 - TRACE_RING_EVENTS : 0;
+
+        for (uint64_t i = begin > valid ? begin : valid; i < head; i++) {
+            write_event(out, &copy[i - begin], pid, &async_id, &first);
+        }
+    }
+    fprintf(out, "\n]}\n");
+
+    free(copy);
+    return ferror(out) ? -1 : 0;
+}
+
+// Exporta os eventos em uma string alocada
+char *trace_dump_json() {
+    char *data = NULL;
+    size_t length = 0;
+    FILE *out = open_memstream(&data, &length);
+    if (!out) {
+        return NULL;
+    }
+
+    int failed = write_trace(out) != 0;
+    failed |= fclose(out) != 0;
+    if (failed) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+// Exporta os eventos para um arquivo
+int trace_dump_file(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        return -1;
+    }
+
+    int failed = write_trace(out) != 0;
+    failed |= fclose(out) != 0;
+    return failed ? -1 : 0;
+}
+
+// Tratador de sinais: apenas acorda a thread que grava o arquivo
+static void handle_dump_signal(int signum) {
+    (void)signum;
+    int saved_errno = errno;
+    ssize_t ignored = write(signal_pipe[1], "x", 1);
+    (void)ignored;
+    errno = saved_errno;
+}
+
+// Grava o arquivo a cada sinal recebido
+static void *dump_loop(void *arg) {
+    (void)arg;
+    char byte;
+
+    while (1) {
+        ssize_t length = read(signal_pipe[0], &byte, 1);
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            return NULL;
+        }
+
+        if (trace_dump_file(TRACE_DUMP_PATH) == 0) {
+            printf("Rastreamento gravado em %s\n", TRACE_DUMP_PATH);
+        } else {
+            fprintf(stderr, "Erro ao gravar o rastreamento em %s: %s\n", TRACE_DUMP_PATH, strerror(errno));
+        }
+    }
+}
+
+// Instala o tratador do sinal e inicia a thread que grava o arquivo
+int trace_signal_start(int signum) {
+    pthread_t thread_id;
+
+    if (pipe(signal_pipe) != 0) {
+        return -1;
+    }
+    fcntl(signal_pipe[1], F_SETFL, O_NONBLOCK);
+    if (pthread_create(&thread_id, NULL, dump_loop, NULL) != 0) {
+        close(signal_pipe[0]);
+        close(signal_pipe[1]);
+        return -1;
+    }
+    pthread_detach(thread_id);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_dump_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    return sigaction(signum, &action, NULL);
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Rastreamento das etapas de cada requisição (espera por db_mutex, leitura do
+// banco de dados, formatação e envio da resposta). Só é compilado com
+// TRACE_ENABLED (make TRACE=1); sem ele, as macros abaixo não geram código.
+
+// Eventos guardados por thread; ao encher, os mais antigos são sobrescritos
+#define TRACE_RING_EVENTS 4096
+
+// Arquivo gravado quando o servidor recebe SIGUSR1
+#define TRACE_DUMP_PATH "/tmp/movies-trace.json"
+
+#ifdef TRACE_ENABLED
+
+// Relógio monotônico em nanossegundos
+uint64_t trace_clock_ns();
+
+// Registra na thread atual uma etapa iniciada em start e concluída agora
+// (bytes negativo quando não se aplica). name deve ser uma string constante.
+void trace_record(const char *name, uint64_t start, int64_t bytes);
+
+// Registra uma etapa que prosseguiu fora da thread (por exemplo, um envio
+// entregue ao kernel); ela aparece à parte, sem se aninhar às demais
+void trace_record_async(const char *name, uint64_t start, int64_t bytes);
+
+// Início e fim de uma requisição: as etapas registradas entre as duas chamadas,
+// na mesma thread, levam o número da requisição
+uint64_t trace_request_begin();
+void trace_request_end(uint64_t start);
+
+// Exporta os eventos de todas as threads no formato JSON do Chrome trace
+// (aceito pelo Perfetto); retorna NULL se faltar memória
+char *trace_dump_json();
+
+// Grava a exportação em path; retorna 0 em caso de sucesso
+int trace_dump_file(const char *path);
+
+// Grava TRACE_DUMP_PATH sempre que o processo receber o sinal signum
+int trace_signal_start(int signum);
+
+#define TRACE_BEGIN(span) uint64_t span = trace_clock_ns()
+#define TRACE_END(span, name) trace_record((name), (span), -1)
+#define TRACE_END_BYTES(span, name, bytes) trace_record((name), (span), (int64_t)(bytes))
+#define TRACE_REQUEST_BEGIN(span) uint64_t span = trace_request_begin()
+#define TRACE_REQUEST_END(span) trace_request_end(span)
+
+#else
+
+#define TRACE_BEGIN(span) ((void)0)
+#define TRACE_END(span, name) ((void)0)
+#define TRACE_END_BYTES(span, name, bytes) ((void)sizeof(bytes))
+#define TRACE_REQUEST_BEGIN(span) ((void)0)
+#define TRACE_REQUEST_END(span) ((void)0)
+
+#endif
+
+#endif
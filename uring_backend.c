@@ -0,0 +1,1076 @@
+#include "uring_backend.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+
+// Tamanho das filas de submissão e de conclusão
+#define RING_ENTRIES 256
+
+// Buffers fornecidos ao kernel para o recv multishot
+#define RECV_BUFFER_COUNT 256
+#define RECV_BUFFER_SIZE 4096
+#define RECV_BUFFER_GROUP 0
+
+// Blocos recebidos que podem aguardar um trabalhador antes de a leitura ser pausada
+#define INPUT_HIGH_WATER 16
+
+// Tipo de operação, guardado nos bits baixos do user_data
+enum {
+    OP_RECV = 1,
+    OP_SEND = 2,
+    OP_CANCEL = 3,
+    OP_ACCEPT = 4,
+    OP_SHUTDOWN = 5,
+    OP_DRAIN_TIMEOUT = 6,
+    OP_WAKE = 7,
+};
+#define OP_MASK 7ULL
+
+// Filas do io_uring mapeadas na memória do processo
+typedef struct {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned sq_entries;
+    unsigned sq_local_tail;
+    unsigned to_submit;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    size_t sqes_size;
+} uring;
+
+// Anel de buffers fornecidos ao kernel
+typedef struct {
+    struct io_uring_buf_ring *ring;
+    size_t ring_size;
+    char *buffers;
+    unsigned short tail;
+} buffer_ring;
+
+// Bloco de dados recebido de um cliente, aguardando um trabalhador; pode conter
+// várias requisições ou só parte de uma
+typedef struct uring_input {
+    struct uring_input *next;
+    char data[];
+} uring_input;
+
+// Lote de requisições de uma conexão entregue a um trabalhador. O trabalhador
+// atende pela cópia view, com uma fila de saída própria, para não disputar a fila
+// da conexão com os envios em andamento; o laço de eventos junta as duas ao final.
+typedef struct uring_job {
+    struct uring_job *next;
+    struct uring_conn *uc;
+    uring_input *inputs;
+    connection view;
+    int closing;
+} uring_job;
+
+// Estado de uma conexão atendida pelo backend
+typedef struct uring_conn {
+    connection conn;
+    struct uring_conn *prev;
+    struct uring_conn *next;
+    struct uring_conn *next_dirty;
+    int dirty;
+    int recv_armed;
+    int send_inflight;
+    int cancel_inflight;
+    int paused;
+    int closing;
+    int job_inflight;
+    int queued_inputs;
+    uring_input *inputs;
+    uring_input **inputs_tail;
+    uring_job job;
+    struct msghdr message;
+    struct iovec iov[OUTPUT_MAX_IOV];
+#ifdef TRACE_ENABLED
+    uint64_t send_started;
+#endif
+} uring_conn;
+
+// Trabalhadores que executam as requisições fora do laço de eventos. Cada conexão
+// tem no máximo um lote em andamento, o que preserva a ordem das respostas.
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t ready;
+    uring_job *pending;
+    uring_job **pending_tail;
+    uring_job *done;
+    int stopping;
+    int event_fd;
+    input_handler handler;
+    pthread_t threads[URING_MAX_WORKERS];
+    int thread_count;
+} worker_pool;
+
+// Estado do laço de eventos
+typedef struct {
+    uring ring;
+    worker_pool workers;
+    uint64_t wake_count;
+    buffer_ring buffers;
+    int listen_fds[URING_MAX_LISTENERS];
+    int listen_count;
+    int shutdown_fd;
+    int shutting_down;
+    int drain_expired;
+    uring_conn *connections;
+    uring_conn *dirty;
+    struct __kernel_timespec drain_timeout;
+} uring_server;
+
+// ---------------------------------------------------------------------------
+// Acesso direto à interface do kernel
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// Cria o anel e mapeia as filas
+static int ring_init(uring *ring) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = sys_io_uring_setup(RING_ENTRIES, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+        close(ring->fd);
+        return -1;
+    }
+
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->cq_size > ring->sq_size) {
+        ring->sq_size = ring->cq_size;
+    }
+    ring->cq_size = ring->sq_size;
+
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+    ring->cq_ptr = ring->sq_ptr;
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        munmap(ring->sq_ptr, ring->sq_size);
+        close(ring->fd);
+        return -1;
+    }
+
+    char *sq = ring->sq_ptr;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->sq_local_tail = *ring->sq_tail;
+
+    char *cq = ring->cq_ptr;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+// Desfaz os mapeamentos e fecha o anel
+static void ring_free(uring *ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->sq_ptr, ring->sq_size);
+    close(ring->fd);
+}
+
+// Publica as submissões pendentes e, opcionalmente, aguarda conclusões
+static int ring_submit(uring *ring, unsigned wait) {
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+    unsigned to_submit = ring->to_submit;
+    ring->to_submit = 0;
+
+    while (1) {
+        int result = sys_io_uring_enter(ring->fd, to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+        if (result >= 0 || errno != EINTR) {
+            return result;
+        }
+        to_submit = 0;
+    }
+}
+
+// Obtém uma entrada livre na fila de submissão, submetendo a fila se estiver cheia
+static struct io_uring_sqe *ring_get_sqe(uring *ring) {
+    while (ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        if (ring_submit(ring, 0) < 0) {
+            return NULL;
+        }
+    }
+
+    unsigned index = ring->sq_local_tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+    ring->to_submit++;
+    return sqe;
+}
+
+// Verifica se o kernel oferece todas as operações usadas pelo backend
+static int ring_supports_ops(uring *ring) {
+    static const unsigned char used_ops[] = {
+        IORING_OP_ACCEPT, IORING_OP_RECV,    IORING_OP_SENDMSG,      IORING_OP_POLL_ADD,
+        IORING_OP_READ,   IORING_OP_TIMEOUT, IORING_OP_ASYNC_CANCEL,
+    };
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    if (!probe) {
+        return 0;
+    }
+
+    int supported = sys_io_uring_register(ring->fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    for (size_t i = 0; supported && i < sizeof(used_ops); i++) {
+        supported = used_ops[i] <= probe->last_op && (probe->ops[used_ops[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return supported;
+}
+
+// Aguarda a próxima conclusão e a retira da fila; usada antes de o laço de eventos começar
+static int ring_wait_cqe(uring *ring, struct io_uring_cqe *cqe) {
+    while (1) {
+        unsigned head = *ring->cq_head;
+        if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            *cqe = ring->cqes[head & ring->cq_mask];
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+        if (ring_submit(ring, 1) < 0) {
+            return -1;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Buffers fornecidos ao kernel
+
+// Devolve um buffer ao anel para ser usado em novas leituras
+static void buffers_recycle(buffer_ring *buffers, unsigned short id) {
+    struct io_uring_buf *buf = &buffers->ring->bufs[buffers->tail & (RECV_BUFFER_COUNT - 1)];
+    buf->addr = (unsigned long)(buffers->buffers + (size_t)id * RECV_BUFFER_SIZE);
+    buf->len = RECV_BUFFER_SIZE;
+    buf->bid = id;
+    buffers->tail++;
+    __atomic_store_n(&buffers->ring->tail, buffers->tail, __ATOMIC_RELEASE);
+}
+
+// Aloca e registra o anel de buffers
+static int buffers_init(buffer_ring *buffers, uring *ring) {
+    buffers->ring_size = RECV_BUFFER_COUNT * sizeof(struct io_uring_buf);
+    buffers->ring = mmap(NULL, buffers->ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers->ring == MAP_FAILED) {
+        return -1;
+    }
+
+    buffers->buffers = malloc((size_t)RECV_BUFFER_COUNT * RECV_BUFFER_SIZE);
+    if (!buffers->buffers) {
+        munmap(buffers->ring, buffers->ring_size);
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)buffers->ring;
+    reg.ring_entries = RECV_BUFFER_COUNT;
+    reg.bgid = RECV_BUFFER_GROUP;
+
+    if (sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        free(buffers->buffers);
+        munmap(buffers->ring, buffers->ring_size);
+        return -1;
+    }
+
+    buffers->tail = 0;
+    for (unsigned short id = 0; id < RECV_BUFFER_COUNT; id++) {
+        buffers_recycle(buffers, id);
+    }
+    return 0;
+}
+
+// Libera a memória do anel de buffers (o registro é desfeito ao fechar o anel)
+static void buffers_free(buffer_ring *buffers) {
+    free(buffers->buffers);
+    munmap(buffers->ring, buffers->ring_size);
+}
+
+// ---------------------------------------------------------------------------
+// Verificação do accept e do recv multishot
+
+// Identificação das operações de teste (o laço de eventos ainda não começou)
+#define PROBE_ACCEPT 1ULL
+#define PROBE_RECV 2ULL
+#define PROBE_CANCEL 3ULL
+
+// Submete uma operação de teste; retorna -1 se a fila de submissão falhar
+static int probe_submit(uring *ring, unsigned char opcode, int fd, unsigned long long target,
+                        unsigned long long user_data) {
+    struct io_uring_sqe *sqe = ring_get_sqe(ring);
+    if (!sqe) {
+        return -1;
+    }
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = user_data;
+    if (opcode == IORING_OP_ACCEPT) {
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    } else if (opcode == IORING_OP_RECV) {
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RECV_BUFFER_GROUP;
+    } else {
+        sqe->addr = target;
+    }
+    return 0;
+}
+
+// Executa um accept e um recv multishot em um par de sockets Unix de teste. Algumas
+// versões do kernel conhecem as operações mas recusam o modo multishot (ou só o do
+// accept, como o 5.19); nesses casos o backend não é usado.
+static int ring_supports_multishot(uring_server *server) {
+    uring *ring = &server->ring;
+    struct io_uring_cqe cqe;
+    struct sockaddr_un address;
+    socklen_t length = sizeof(sa_family_t);
+    int supported = 0;
+    int armed = 0;
+    int accepted = -1;
+    int client = -1;
+
+    // Socket de escuta em um endereço abstrato escolhido pelo kernel
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&address, length) != 0 || listen(listener, 1) != 0) {
+        goto done;
+    }
+    length = sizeof(address);
+    if (getsockname(listener, (struct sockaddr *)&address, &length) != 0) {
+        goto done;
+    }
+
+    client = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client < 0 || probe_submit(ring, IORING_OP_ACCEPT, listener, 0, PROBE_ACCEPT) != 0 ||
+        connect(client, (struct sockaddr *)&address, length) != 0 || ring_wait_cqe(ring, &cqe) != 0) {
+        goto done;
+    }
+    if (cqe.res >= 0) {
+        accepted = cqe.res;
+    }
+    if (cqe.flags & IORING_CQE_F_MORE) {
+        armed++;
+    }
+    if (accepted < 0 || !(cqe.flags & IORING_CQE_F_MORE)) {
+        goto cancel;
+    }
+
+    if (probe_submit(ring, IORING_OP_RECV, accepted, 0, PROBE_RECV) != 0 || write(client, "x", 1) != 1 ||
+        ring_wait_cqe(ring, &cqe) != 0) {
+        goto cancel;
+    }
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        buffers_recycle(&server->buffers, cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    }
+    if (cqe.flags & IORING_CQE_F_MORE) {
+        armed++;
+        supported = cqe.res == 1;
+    }
+
+cancel:
+    // Cancela as operações que continuam ativas e espera suas últimas conclusões
+    if (armed > 0) {
+        int pending = 0;
+        if (probe_submit(ring, IORING_OP_ASYNC_CANCEL, -1, PROBE_ACCEPT, PROBE_CANCEL) == 0) {
+            pending += 2;
+        }
+        if (armed > 1 && probe_submit(ring, IORING_OP_ASYNC_CANCEL, -1, PROBE_RECV, PROBE_CANCEL) == 0) {
+            pending += 2;
+        }
+        while (pending > 0 && ring_wait_cqe(ring, &cqe) == 0) {
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                buffers_recycle(&server->buffers, cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            }
+            if (cqe.user_data == PROBE_CANCEL || !(cqe.flags & IORING_CQE_F_MORE)) {
+                pending--;
+            }
+        }
+        if (pending > 0) {
+            supported = 0;
+        }
+    }
+
+done:
+    if (accepted >= 0) {
+        close(accepted);
+    }
+    if (client >= 0) {
+        close(client);
+    }
+    if (listener >= 0) {
+        close(listener);
+    }
+    return supported;
+}
+
+// ---------------------------------------------------------------------------
+// Trabalhadores
+
+// Atende as requisições de um lote na ordem em que chegaram; após "exit", as demais são
+// descartadas, assim como as que restam quando o prazo de encerramento se esgota
+static void run_job(worker_pool *pool, uring_job *job) {
+    while (job->inputs) {
+        uring_input *input = job->inputs;
+        job->inputs = input->next;
+        if (__atomic_load_n(&pool->stopping, __ATOMIC_RELAXED)) {
+            job->closing = 1;
+        }
+        if (!job->closing && pool->handler(&job->view, input->data)) {
+            job->closing = 1;
+        }
+        free(input);
+    }
+}
+
+// Executa lotes até o encerramento e avisa o laço de eventos pelo eventfd a cada lote concluído
+static void *worker_main(void *arg) {
+    worker_pool *pool = arg;
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        while (!pool->pending && !pool->stopping) {
+            pthread_cond_wait(&pool->ready, &pool->mutex);
+        }
+        if (pool->stopping) {
+            break;
+        }
+
+        uring_job *job = pool->pending;
+        pool->pending = job->next;
+        if (!pool->pending) {
+            pool->pending_tail = &pool->pending;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_job(pool, job);
+
+        pthread_mutex_lock(&pool->mutex);
+        job->next = pool->done;
+        pool->done = job;
+        ssize_t ignored = write(pool->event_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+// Encerra os trabalhadores; lotes ainda não iniciados são abandonados
+static void workers_stop(worker_pool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    __atomic_store_n(&pool->stopping, 1, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&pool->ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    close(pool->event_fd);
+    pthread_cond_destroy(&pool->ready);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+// Cria o eventfd e um trabalhador por processador, até URING_MAX_WORKERS; há ao menos
+// dois para que uma requisição bloqueada (gravação do arquivo) não atrase as demais
+static int workers_start(worker_pool *pool, input_handler handler) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int count = processors < 2 ? 2 : processors > URING_MAX_WORKERS ? URING_MAX_WORKERS : (int)processors;
+
+    pool->event_fd = eventfd(0, EFD_CLOEXEC);
+    if (pool->event_fd < 0) {
+        return -1;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+    pool->pending = NULL;
+    pool->pending_tail = &pool->pending;
+    pool->done = NULL;
+    pool->stopping = 0;
+    pool->handler = handler;
+    pool->thread_count = 0;
+
+    while (pool->thread_count < count) {
+        if (pthread_create(&pool->threads[pool->thread_count], NULL, worker_main, pool) != 0) {
+            break;
+        }
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0) {
+        workers_stop(pool);
+        return -1;
+    }
+    return 0;
+}
+
+// Entrega um lote aos trabalhadores
+static void workers_submit(worker_pool *pool, uring_job *job) {
+    job->next = NULL;
+    pthread_mutex_lock(&pool->mutex);
+    *pool->pending_tail = job;
+    pool->pending_tail = &job->next;
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Retira os lotes concluídos desde a última chamada
+static uring_job *workers_take_done(worker_pool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    uring_job *done = pool->done;
+    pool->done = NULL;
+    pthread_mutex_unlock(&pool->mutex);
+    return done;
+}
+
+// ---------------------------------------------------------------------------
+// Submissões
+
+// O índice do socket de escuta segue o tipo de operação no user_data do accept
+static void submit_accept(uring_server *server, int index) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server->listen_fds[index];
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = OP_ACCEPT | ((unsigned long long)index << 3);
+}
+
+static void submit_cancel_accept(uring_server *server, int index) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = OP_ACCEPT | ((unsigned long long)index << 3);
+    sqe->user_data = OP_CANCEL;
+}
+
+static void submit_shutdown_poll(uring_server *server) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = server->shutdown_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = OP_SHUTDOWN;
+}
+
+// Aguarda o aviso dos trabalhadores de que há lotes concluídos
+static void submit_wake(uring_server *server) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = server->workers.event_fd;
+    sqe->addr = (unsigned long)&server->wake_count;
+    sqe->len = sizeof(server->wake_count);
+    sqe->user_data = OP_WAKE;
+}
+
+static void submit_drain_timeout(uring_server *server) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe) {
+        return;
+    }
+    server->drain_timeout.tv_sec = SHUTDOWN_DRAIN_MS / 1000;
+    server->drain_timeout.tv_nsec = (SHUTDOWN_DRAIN_MS % 1000) * 1000000L;
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->addr = (unsigned long)&server->drain_timeout;
+    sqe->len = 1;
+    sqe->user_data = OP_DRAIN_TIMEOUT;
+}
+
+static void submit_recv(uring_server *server, uring_conn *uc) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = uc->conn.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->user_data = (unsigned long)uc | OP_RECV;
+    uc->recv_armed = 1;
+}
+
+static void submit_cancel_recv(uring_server *server, uring_conn *uc) {
+    if (!uc->recv_armed || uc->cancel_inflight) {
+        return;
+    }
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = (unsigned long)uc | OP_RECV;
+    sqe->user_data = (unsigned long)uc | OP_CANCEL;
+    uc->cancel_inflight = 1;
+}
+
+static void submit_send(uring_server *server, uring_conn *uc) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe) {
+        return;
+    }
+
+    memset(&uc->message, 0, sizeof(uc->message));
+    uc->message.msg_iov = uc->iov;
+    uc->message.msg_iovlen = output_queue_iov(&uc->conn.out, uc->iov, OUTPUT_MAX_IOV);
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = uc->conn.fd;
+    sqe->addr = (unsigned long)&uc->message;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (unsigned long)uc | OP_SEND;
+    uc->send_inflight = 1;
+#ifdef TRACE_ENABLED
+    uc->send_started = trace_clock_ns();
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Conexões
+
+// Marca a conexão para ser revisada ao final da rodada de conclusões
+static void mark_dirty(uring_server *server, uring_conn *uc) {
+    if (!uc->dirty) {
+        uc->dirty = 1;
+        uc->next_dirty = server->dirty;
+        server->dirty = uc;
+    }
+}
+
+// Aceita um novo cliente
+static void open_connection(uring_server *server, int fd) {
+    // Recusa o cliente de forma educada se o limite de conexões foi atingido
+    if (server->shutting_down || connection_slot_acquire() != 0) {
+        const char *busy = "Erro: servidor lotado, tente novamente mais tarde";
+        send(fd, busy, strlen(busy) + 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+        close(fd);
+        return;
+    }
+
+    uring_conn *uc = calloc(1, sizeof(uring_conn));
+    if (!uc) {
+        close(fd);
+        connection_slot_release();
+        return;
+    }
+
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    connection_init(&uc->conn, fd);
+    uc->inputs_tail = &uc->inputs;
+    uc->job.uc = uc;
+
+    uc->next = server->connections;
+    if (server->connections) {
+        server->connections->prev = uc;
+    }
+    server->connections = uc;
+
+    submit_recv(server, uc);
+}
+
+// Descarta as requisições recebidas que ainda não foram entregues a um trabalhador
+static void discard_inputs(uring_conn *uc) {
+    while (uc->inputs) {
+        uring_input *input = uc->inputs;
+        uc->inputs = input->next;
+        free(input);
+    }
+    uc->inputs_tail = &uc->inputs;
+    uc->queued_inputs = 0;
+}
+
+// Entrega aos trabalhadores, em um único lote, os blocos recebidos até agora. A cópia
+// da conexão leva apenas o que o tratador usa, inclusive a linha incompleta da leitura
+// anterior, que o tratador completa com os novos blocos; a fila de saída começa vazia.
+static void dispatch_inputs(uring_server *server, uring_conn *uc) {
+    if (uc->job_inflight || !uc->inputs) {
+        return;
+    }
+
+    uring_job *job = &uc->job;
+    memset(&job->view, 0, sizeof(job->view));
+    job->view.fd = uc->conn.fd;
+    job->view.peer = uc->conn.peer;
+    job->view.compressor = uc->conn.compressor;
+    job->view.in = uc->conn.in;
+    output_queue_init(&job->view.out);
+    job->inputs = uc->inputs;
+    job->closing = 0;
+
+    uc->inputs = NULL;
+    uc->inputs_tail = &uc->inputs;
+    uc->queued_inputs = 0;
+    uc->job_inflight = 1;
+    workers_submit(&server->workers, job);
+}
+
+// Libera a conexão quando não há mais operações em andamento
+static void release_connection(uring_server *server, uring_conn *uc) {
+    if (uc->prev) {
+        uc->prev->next = uc->next;
+    } else {
+        server->connections = uc->next;
+    }
+    if (uc->next) {
+        uc->next->prev = uc->prev;
+    }
+
+    discard_inputs(uc);
+    int timed_out = connection_timed_out(&uc->conn);
+    connection_close(&uc->conn);
+    connection_slot_release();
+    free(uc);
+    printf(timed_out ? "Cliente desconectado por inatividade\n" : "Cliente desconectado\n");
+}
+
+// Decide o próximo passo de uma conexão após as conclusões da rodada
+static void review_connection(uring_server *server, uring_conn *uc) {
+    uc->dirty = 0;
+
+    if (uc->closing) {
+        // Termina de atender as requisições já recebidas e de enviar as respostas antes de fechar;
+        // com erro no socket, só espera o lote em andamento, que ainda usa a conexão
+        if (uc->closing == 1) {
+            dispatch_inputs(server, uc);
+            if (uc->conn.out.pending > 0 && !uc->send_inflight) {
+                submit_send(server, uc);
+            }
+        }
+        if (uc->recv_armed) {
+            submit_cancel_recv(server, uc);
+        }
+        if (!uc->recv_armed && !uc->send_inflight && !uc->cancel_inflight && !uc->job_inflight &&
+            ((uc->conn.out.pending == 0 && !uc->inputs) || uc->closing == 2)) {
+            release_connection(server, uc);
+        }
+        return;
+    }
+
+    dispatch_inputs(server, uc);
+
+    // Todas as respostas da rodada seguem em um único envio vetorizado
+    if (uc->conn.out.pending > 0 && !uc->send_inflight) {
+        submit_send(server, uc);
+    }
+
+    // Pausa a leitura de clientes que não consomem as respostas ou que enviam
+    // requisições mais depressa do que os trabalhadores as atendem
+    if (uc->conn.out.pending >= OUTPUT_HIGH_WATER || uc->queued_inputs >= INPUT_HIGH_WATER) {
+        uc->paused = 1;
+        submit_cancel_recv(server, uc);
+    } else if (uc->paused && uc->conn.out.pending <= OUTPUT_LOW_WATER && uc->queued_inputs == 0) {
+        uc->paused = 0;
+    }
+
+    if (!uc->paused && !uc->recv_armed && !uc->cancel_inflight) {
+        submit_recv(server, uc);
+    }
+}
+
+// Trata dados recebidos em um buffer fornecido ao kernel
+static void handle_recv(uring_server *server, uring_conn *uc, struct io_uring_cqe *cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        uc->recv_armed = 0;
+    }
+
+    if (cqe->res <= 0) {
+        // Sem buffers livres o recv é apenas rearmado; fim de arquivo ou erro encerram a conexão
+        if (cqe->res != -ENOBUFS && cqe->res != -ECANCELED) {
+            uc->closing = 2;
+        }
+        mark_dirty(server, uc);
+        return;
+    }
+
+    // Os dados são copiados para fora do buffer, que volta logo ao kernel, e aguardam
+    // um trabalhador: o tratador pode bloquear (db_mutex, gravação do arquivo) e não
+    // roda no laço de eventos
+    unsigned short id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    uring_input *input = NULL;
+    if (!uc->closing) {
+        input = malloc(sizeof(uring_input) + cqe->res + 1);
+    }
+    if (input) {
+        memcpy(input->data, server->buffers.buffers + (size_t)id * RECV_BUFFER_SIZE, cqe->res);
+        input->data[cqe->res] = '\0';
+        input->next = NULL;
+        *uc->inputs_tail = input;
+        uc->inputs_tail = &input->next;
+        uc->queued_inputs++;
+        connection_touch(&uc->conn);
+    } else if (!uc->closing) {
+        uc->closing = 2;
+    }
+    buffers_recycle(&server->buffers, id);
+    mark_dirty(server, uc);
+}
+
+// Recolhe os lotes concluídos pelos trabalhadores: as respostas vão para a fila de
+// saída da conexão, e a linha ainda incompleta e o estado da compressão, possivelmente
+// negociada no lote, voltam para ela
+static void handle_wake(uring_server *server, struct io_uring_cqe *cqe) {
+    uring_job *job = workers_take_done(&server->workers);
+
+    while (job) {
+        uring_job *next = job->next;
+        uring_conn *uc = job->uc;
+
+        uc->job_inflight = 0;
+        uc->conn.compressor = job->view.compressor;
+        uc->conn.in = job->view.in;
+        output_queue_move(&uc->conn.out, &job->view.out);
+        if (job->closing) {
+            // O cliente pediu para sair: o que chegou depois de "exit" não é atendido
+            discard_inputs(uc);
+            if (!uc->closing) {
+                uc->closing = 1;
+            }
+        }
+        mark_dirty(server, uc);
+        job = next;
+    }
+
+    if (cqe->res < 0 && cqe->res != -EINTR && cqe->res != -EAGAIN) {
+        fprintf(stderr, "Falha ao ler o eventfd dos trabalhadores: %s\n", strerror(-cqe->res));
+    }
+    submit_wake(server);
+}
+
+// Trata a conclusão de um envio
+static void handle_send(uring_server *server, uring_conn *uc, struct io_uring_cqe *cqe) {
+    uc->send_inflight = 0;
+#ifdef TRACE_ENABLED
+    trace_record_async("send", uc->send_started, cqe->res);
+#endif
+
+    if (cqe->res < 0) {
+        uc->closing = 2;
+    } else if (cqe->res > 0) {
+        output_queue_consume(&uc->conn.out, cqe->res);
+        connection_touch(&uc->conn);
+    }
+    mark_dirty(server, uc);
+}
+
+// Inicia o encerramento: para de aceitar e deixa os clientes terminarem
+static void begin_shutdown(uring_server *server) {
+    printf("Encerrando servidor...\n");
+    server->shutting_down = 1;
+
+    // O accept multishot mantém o socket de escuta aberto até ser cancelado
+    for (int i = 0; i < server->listen_count; i++) {
+        submit_cancel_accept(server, i);
+    }
+    submit_drain_timeout(server);
+
+    for (uring_conn *uc = server->connections; uc; uc = uc->next) {
+        if (!uc->closing) {
+            uc->closing = 1;
+        }
+        mark_dirty(server, uc);
+    }
+}
+
+// Laço principal de eventos
+static void event_loop(uring_server *server) {
+    submit_shutdown_poll(server);
+    submit_wake(server);
+    for (int i = 0; i < server->listen_count; i++) {
+        submit_accept(server, i);
+    }
+
+    while (!(server->shutting_down && (!server->connections || server->drain_expired))) {
+        if (ring_submit(&server->ring, 1) < 0) {
+            perror("Falha no io_uring_enter");
+            break;
+        }
+
+        // Processa todas as conclusões disponíveis antes de submeter novos envios
+        unsigned head = *server->ring.cq_head;
+        unsigned tail = __atomic_load_n(server->ring.cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++) {
+            struct io_uring_cqe *cqe = &server->ring.cqes[head & server->ring.cq_mask];
+            unsigned long long op = cqe->user_data & OP_MASK;
+            uring_conn *uc = (uring_conn *)(unsigned long)(cqe->user_data & ~OP_MASK);
+
+            switch (op) {
+            case OP_ACCEPT:
+                if (cqe->res >= 0) {
+                    open_connection(server, cqe->res);
+                } else if (cqe->res != -ECANCELED && !server->shutting_down) {
+                    fprintf(stderr, "Falha ao aceitar conexão: %s\n", strerror(-cqe->res));
+                }
+                if (!(cqe->flags & IORING_CQE_F_MORE) && !server->shutting_down) {
+                    submit_accept(server, (int)(cqe->user_data >> 3));
+                }
+                break;
+            case OP_SHUTDOWN:
+                begin_shutdown(server);
+                break;
+            case OP_DRAIN_TIMEOUT:
+                server->drain_expired = 1;
+                break;
+            case OP_WAKE:
+                handle_wake(server, cqe);
+                break;
+            case OP_RECV:
+                handle_recv(server, uc, cqe);
+                break;
+            case OP_SEND:
+                handle_send(server, uc, cqe);
+                break;
+            case OP_CANCEL:
+                if (uc) {
+                    uc->cancel_inflight = 0;
+                    mark_dirty(server, uc);
+                }
+                break;
+            }
+        }
+        __atomic_store_n(server->ring.cq_head, head, __ATOMIC_RELEASE);
+
+        while (server->dirty) {
+            uring_conn *uc = server->dirty;
+            server->dirty = uc->next_dirty;
+            review_connection(server, uc);
+        }
+    }
+
+    if (server->drain_expired && server->connections) {
+        fprintf(stderr, "Prazo de encerramento esgotado com clientes ainda conectados\n");
+    }
+}
+
+// Fecha os clientes que não terminaram no prazo de encerramento e libera suas vagas,
+// para que o chamador não espere por eles outra vez. As estruturas das conexões ficam
+// alocadas: o kernel ainda pode estar desfazendo, após o fechamento do anel, as
+// operações que apontam para elas; o processo está terminando.
+static void abandon_connections(uring_server *server) {
+    for (uring_conn *uc = server->connections; uc; uc = uc->next) {
+        connection_close(&uc->conn);
+        connection_slot_release();
+    }
+    server->connections = NULL;
+}
+
+// Prepara o anel e executa o laço de eventos
+int uring_backend_run(const int *listen_fds, int listen_count, int shutdown_fd, input_handler handler) {
+    uring_server server;
+    memset(&server, 0, sizeof(server));
+    if (listen_count > URING_MAX_LISTENERS) {
+        return -1;
+    }
+    memcpy(server.listen_fds, listen_fds, listen_count * sizeof(int));
+    server.listen_count = listen_count;
+    server.shutdown_fd = shutdown_fd;
+
+    if (ring_init(&server.ring) != 0) {
+        return -1;
+    }
+    if (!ring_supports_ops(&server.ring) || buffers_init(&server.buffers, &server.ring) != 0) {
+        ring_free(&server.ring);
+        return -1;
+    }
+    if (!ring_supports_multishot(&server) || workers_start(&server.workers, handler) != 0) {
+        ring_free(&server.ring);
+        buffers_free(&server.buffers);
+        return -1;
+    }
+
+    printf("Backend io_uring ativo com %d trabalhadores\n", server.workers.thread_count);
+    event_loop(&server);
+
+    // Espera os lotes em andamento antes de liberar o anel (o eventfd ainda é lido por ele)
+    workers_stop(&server.workers);
+    ring_free(&server.ring);
+    abandon_connections(&server);
+    buffers_free(&server.buffers);
+    return 0;
+}
+
+#else
+
+// Sem suporte a io_uring na plataforma: o chamador usa o backend de threads
+int uring_backend_run(const int *listen_fds, int listen_count, int shutdown_fd, input_handler handler) {
+    (void)listen_fds;
+    (void)listen_count;
+    (void)shutdown_fd;
+    (void)handler;
+    return -1;
+}
+
+#endif
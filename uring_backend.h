@@ -0,0 +1,20 @@
+#ifndef URING_BACKEND_H
+#define URING_BACKEND_H
+
+#include "connection.h"
+
+// Número máximo de sockets de escuta atendidos pelo backend
+#define URING_MAX_LISTENERS 4
+
+// Número máximo de trabalhadores que executam as requisições (um por processador, no mínimo dois)
+#define URING_MAX_WORKERS 16
+
+// Executa o servidor com io_uring (accept e recv multishot, buffers fornecidos ao
+// kernel e envios agrupados) até que shutdown_fd se torne legível e os clientes
+// sejam atendidos. O laço de eventos só faz E/S: handler roda em trabalhadores,
+// que devolvem as respostas ao laço por um eventfd lido pelo próprio anel.
+// Retorna -1, sem aceitar nenhuma conexão, se o kernel não oferecer os recursos
+// necessários; nesse caso o chamador usa o backend de threads.
+int uring_backend_run(const int *listen_fds, int listen_count, int shutdown_fd, input_handler handler);
+
+#endif